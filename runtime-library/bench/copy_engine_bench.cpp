@@ -0,0 +1,84 @@
+// Compares the copy engine against a single memcpy for output-sized buffers.
+//
+// Usage: copy_engine_bench [max_threads]
+// Prints one line per buffer size and configuration with the copy bandwidth in GB/s, "nt" marking the
+// configurations with non-temporal stores. Destinations are rotated over more memory than the
+// last-level cache holds, as consecutive inference outputs are.
+
+#include "copy_engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+static const size_t ROTATION_BYTES = 256 * 1024 * 1024;
+
+typedef std::chrono::steady_clock Clock;
+
+static double gbps(size_t bytes, Clock::duration elapsed) {
+    return bytes / std::chrono::duration<double>(elapsed).count() / 1e9;
+}
+
+static void touch(std::vector<char> &buffer) {
+    for (size_t i = 0; i < buffer.size(); i += 4096) buffer[i] = static_cast<char>(i);
+}
+
+// Copies size bytes into each destination in turn for about half a second.
+template <typename CopyFn>
+static double measure(size_t size, std::vector<std::vector<char>> &dsts, const std::vector<char> &src, CopyFn copy) {
+    for (auto &dst : dsts) copy(dst.data(), src.data(), size);   // Warm-up
+    size_t bytes = 0;
+    size_t i = 0;
+    Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do {
+        copy(dsts[i++ % dsts.size()].data(), src.data(), size);
+        bytes += size;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(500));
+    return gbps(bytes, elapsed);
+}
+
+int main(int argc, char **argv) {
+    size_t max_threads = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 4;
+    spdlog::set_level(spdlog::level::warn);
+
+    const size_t sizes[] = {256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024};
+    printf("%-10s %-28s %8s\n", "size", "copy", "GB/s");
+    for (size_t size : sizes) {
+        std::vector<char> src(size);
+        touch(src);
+        std::vector<std::vector<char>> dsts(std::max<size_t>(ROTATION_BYTES / size, 2), std::vector<char>(size));
+        for (auto &dst : dsts) touch(dst);
+        std::string label = std::to_string(size / 1024) + " KiB";
+
+        double memcpy_gbps = measure(size, dsts, src, [](void *dst, const void *s, size_t n) { memcpy(dst, s, n); });
+        printf("%-10s %-28s %8.2f\n", label.c_str(), "memcpy", memcpy_gbps);
+
+        for (size_t threads = 0; threads <= max_threads; threads = threads == 0 ? 1 : threads * 2) {
+            // With copy_stream_threshold_kb left at 0 and set to 256.
+            for (size_t stream_threshold : {size_t(0), size_t(256 * 1024)}) {
+                CopyEngineOptions options;
+                options.threads = threads;
+                options.stream_threshold = stream_threshold;
+                CopyEngine engine;
+                engine.start(options);
+                double engine_gbps = measure(size, dsts, src, [&engine](void *dst, const void *s, size_t n) {
+                    engine.copy({CopyTask{dst, s, n}});
+                });
+                engine.stop();
+                std::string name = "copy engine, " + std::to_string(threads) + " workers" +
+                                   (stream_threshold > 0 ? ", nt" : "");
+                printf("%-10s %-28s %8.2f\n", label.c_str(), name.c_str(), engine_gbps);
+            }
+        }
+    }
+    return 0;
+}
@@ -44,6 +44,57 @@ typedef struct tensors_struct {
   void** data;                   // Data of the tensors
 } tensors_struct;
 
+/**
+ * @brief Memory allocation callbacks used for all tensor memory.
+ *
+ * All three callbacks are required. The aligned_alloc callback must return
+ * memory that can be released with the free callback.
+ */
+typedef struct tensors_allocator {
+  void* (*alloc)(size_t size, void* user_ctx);
+  void* (*aligned_alloc)(size_t alignment, size_t size, void* user_ctx);
+  void (*free)(void* ptr, void* user_ctx);
+  void* user_ctx;  // Passed unchanged to every callback
+} tensors_allocator;
+
+/**
+ * @brief Installs the allocator used by the tensors_struct functions.
+ *
+ * The allocator is copied. It should be installed before any tensor is
+ * allocated, since memory must be released by the allocator that allocated it.
+ *
+ * @param allocator The allocator to install, or NULL to restore malloc/free.
+ * @return 0 on success, -1 if a callback is missing.
+ */
+int set_tensors_allocator(const tensors_allocator* allocator);
+
+/**
+ * @brief Returns whether an allocator other than malloc/free is installed.
+ */
+bool has_custom_tensors_allocator(void);
+
+/**
+ * @brief Allocates memory with the installed allocator.
+ */
+void* tensors_malloc(size_t size);
+
+/**
+ * @brief Allocates aligned memory with the installed allocator.
+ *
+ * @param alignment A power of two multiple of sizeof(void*).
+ */
+void* tensors_aligned_malloc(size_t alignment, size_t size);
+
+/**
+ * @brief Frees memory allocated with the installed allocator. NULL is ignored.
+ */
+void tensors_free(void* ptr);
+
+/**
+ * @brief Duplicates a string with the installed allocator.
+ */
+char* tensors_strdup(const char* str);
+
 /**
  * @brief Allocates and initializes a tensors_struct object.
  *
@@ -62,7 +113,7 @@ tensors_struct* allocate_tensors_struct(int num_tensors);
  * @param tensors Pointer to the tensors_struct to be freed.
  *
  * @note the tensors parameters is assumed to be a valid pointer allocated using
- * malloc.
+ * the installed allocator (malloc by default).
  */
 void deep_free_tensors_struct(tensors_struct* tensors);
 
@@ -106,6 +157,38 @@ void print_tensors_metadata(const tensors_struct* tensors);
  */
 int8_t get_data_type_byte_size(tensor_data_type type);
 
+/**
+ * @brief Converts the elements of a tensor to another data type.
+ *
+ * Supported conversions, vectorized with SSE2/AVX2/F16C on x86 and NEON on
+ * AArch64:
+ *  - DATA_TYPE_INT8/UINT8 to DATA_TYPE_FLOAT: x = (q - zero_point) * scale.
+ *  - DATA_TYPE_FLOAT to DATA_TYPE_INT8/UINT8: q = round(x / scale) +
+ *    zero_point, rounded to nearest even and saturated. NaN maps to the
+ *    lowest value.
+ *  - DATA_TYPE_FLOAT to and from DATA_TYPE_FLOAT16 and DATA_TYPE_BFLOAT16,
+ *    rounded to nearest even, and DATA_TYPE_FLOAT16 to and from
+ *    DATA_TYPE_BFLOAT16. NaN keeps its sign and the top bits of its payload,
+ *    and is made quiet except from DATA_TYPE_BFLOAT16 to DATA_TYPE_FLOAT.
+ *  - Identical types, which are copied.
+ * scale and zero_point are ignored by the conversions that do not quantize.
+ *
+ * @param src The source elements.
+ * @param src_type The data type of the source elements.
+ * @param dst The destination, provided by the caller. It may be src itself
+ *            when the destination type is not larger than the source type;
+ *            other overlaps are rejected.
+ * @param dst_type The data type of the destination elements.
+ * @param count The number of elements.
+ * @param scale The quantization scale, greater than 0.
+ * @param zero_point The quantization zero point.
+ * @return 0 on success, -1 if the conversion is not supported or the buffers
+ *         overlap.
+ */
+int convert_tensor_dtype(const void* src, tensor_data_type src_type,
+                         void* dst, tensor_data_type dst_type, size_t count,
+                         float scale, int32_t zero_point);
+
 /**
  * @brief Compares two tensors_structs for equality.
  *
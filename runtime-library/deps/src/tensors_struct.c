@@ -3,24 +3,193 @@
 
 #include "tensors_struct.h"  // NOLINT(build/include_subdir)
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_WIN32)
+#include <malloc.h>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TENSORS_SSE2 1
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define TENSORS_X86_DISPATCH 1
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define TENSORS_NEON 1
+#endif
+// TENSORS_SIMD_LIMIT caps the conversions to the scalar code (0) or to the
+// baseline vector path, SSE2 or NEON (1), so tests can check every path on
+// any machine.
+#if defined(TENSORS_SIMD_LIMIT) && TENSORS_SIMD_LIMIT < 2
+#undef TENSORS_X86_DISPATCH
+#endif
+#if defined(TENSORS_SIMD_LIMIT) && TENSORS_SIMD_LIMIT < 1
+#undef TENSORS_SSE2
+#undef TENSORS_NEON
+#endif
+
+static void* default_alloc(size_t size, void* user_ctx) {
+  (void)user_ctx;
+  return malloc(size);
+}
+
+#if defined(_WIN32)
+// _aligned_malloc memory must be released with _aligned_free, while
+// default_free also receives plain malloc memory, e.g. input tensors built by
+// the host. The aligned blocks are recorded so that default_free can tell them
+// apart.
+#define ALIGNED_BLOCK_BUCKETS 256
+
+typedef struct aligned_block {
+  void* ptr;
+  struct aligned_block* next;
+} aligned_block;
+
+static aligned_block* aligned_blocks[ALIGNED_BLOCK_BUCKETS];
+static SRWLOCK aligned_blocks_lock = SRWLOCK_INIT;
+
+static size_t aligned_block_bucket(const void* ptr) {
+  uintptr_t value = (uintptr_t)ptr;
+  return (size_t)((value >> 5) ^ (value >> 13)) % ALIGNED_BLOCK_BUCKETS;
+}
+
+// Returns true if ptr was allocated by default_aligned_alloc and forgets it.
+static bool take_aligned_block(void* ptr) {
+  aligned_block* found = NULL;
+  AcquireSRWLockExclusive(&aligned_blocks_lock);
+  aligned_block** link = &aligned_blocks[aligned_block_bucket(ptr)];
+  while (*link != NULL) {
+    if ((*link)->ptr == ptr) {
+      found = *link;
+      *link = found->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  ReleaseSRWLockExclusive(&aligned_blocks_lock);
+  bool taken = found != NULL;
+  free(found);
+  return taken;
+}
+#endif
+
+static void* default_aligned_alloc(size_t alignment, size_t size,
+                                   void* user_ctx) {
+  (void)user_ctx;
+#if defined(_WIN32)
+  if (alignment <= 16) {
+    return malloc(size);  // The alignment malloc guarantees on Windows
+  }
+  aligned_block* block = (aligned_block*)malloc(sizeof(aligned_block));
+  if (block == NULL) {
+    return NULL;
+  }
+  block->ptr = _aligned_malloc(size, alignment);
+  if (block->ptr == NULL) {
+    free(block);
+    return NULL;
+  }
+  AcquireSRWLockExclusive(&aligned_blocks_lock);
+  aligned_block** bucket = &aligned_blocks[aligned_block_bucket(block->ptr)];
+  block->next = *bucket;
+  *bucket = block;
+  ReleaseSRWLockExclusive(&aligned_blocks_lock);
+  return block->ptr;
+#else
+  void* ptr = NULL;
+  if (posix_memalign(&ptr, alignment, size) != 0) {
+    return NULL;
+  }
+  return ptr;
+#endif
+}
+
+static void default_free(void* ptr, void* user_ctx) {
+  (void)user_ctx;
+#if defined(_WIN32)
+  if (ptr != NULL && take_aligned_block(ptr)) {
+    _aligned_free(ptr);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+static tensors_allocator current_allocator = {
+    default_alloc, default_aligned_alloc, default_free, NULL};
+
+int set_tensors_allocator(const tensors_allocator* allocator) {
+  if (allocator == NULL) {
+    current_allocator.alloc = default_alloc;
+    current_allocator.aligned_alloc = default_aligned_alloc;
+    current_allocator.free = default_free;
+    current_allocator.user_ctx = NULL;
+    return 0;
+  }
+  if (allocator->alloc == NULL || allocator->aligned_alloc == NULL ||
+      allocator->free == NULL) {
+    printf("Error: Incomplete tensors allocator\n");
+    return -1;
+  }
+  current_allocator = *allocator;
+  return 0;
+}
+
+bool has_custom_tensors_allocator(void) {
+  return current_allocator.alloc != default_alloc;
+}
+
+void* tensors_malloc(size_t size) {
+  return current_allocator.alloc(size, current_allocator.user_ctx);
+}
+
+void* tensors_aligned_malloc(size_t alignment, size_t size) {
+  return current_allocator.aligned_alloc(alignment, size,
+                                         current_allocator.user_ctx);
+}
+
+void tensors_free(void* ptr) {
+  if (ptr != NULL) {
+    current_allocator.free(ptr, current_allocator.user_ctx);
+  }
+}
+
+char* tensors_strdup(const char* str) {
+  size_t length = strlen(str) + 1;
+  char* copy = (char*)tensors_malloc(length);
+  if (copy != NULL) {
+    memcpy(copy, str, length);
+  }
+  return copy;
+}
+
 tensors_struct* allocate_tensors_struct(int num_tensors) {
-  tensors_struct* tensors = (tensors_struct*)malloc(sizeof(tensors_struct));
+  tensors_struct* tensors =
+      (tensors_struct*)tensors_malloc(sizeof(tensors_struct));
   if (tensors == NULL) {
     return NULL;
   }
   tensors->num_tensors = num_tensors;
-  tensors->names = (char**)malloc(num_tensors * sizeof(char*));
+  tensors->names = (char**)tensors_malloc(num_tensors * sizeof(char*));
   tensors->data_types =
-      (tensor_data_type*)malloc(num_tensors * sizeof(tensor_data_type));
-  tensors->ranks = (size_t*)malloc(num_tensors * sizeof(size_t));
-  tensors->shapes = (size_t**)malloc(num_tensors * sizeof(size_t*));
-  tensors->data = (void**)malloc(num_tensors * sizeof(void*));
+      (tensor_data_type*)tensors_malloc(num_tensors * sizeof(tensor_data_type));
+  tensors->ranks = (size_t*)tensors_malloc(num_tensors * sizeof(size_t));
+  tensors->shapes = (size_t**)tensors_malloc(num_tensors * sizeof(size_t*));
+  tensors->data = (void**)tensors_malloc(num_tensors * sizeof(void*));
   if (tensors->names == NULL || tensors->data_types == NULL ||
       tensors->ranks == NULL || tensors->shapes == NULL ||
       tensors->data == NULL) {
@@ -56,12 +225,577 @@ int8_t get_data_type_byte_size(tensor_data_type type) {
       return sizeof(uint32_t);
     case DATA_TYPE_UINT64:
       return sizeof(uint64_t);
+    case DATA_TYPE_FLOAT16:
+    case DATA_TYPE_BFLOAT16:
+      return sizeof(uint16_t);
     default:
       printf("Error: Unknown data type %d\n", type);
       return 0;  // Return 0 for unknown data types
   }
 }
 
+// Scalar reference conversions. The vector paths below produce bit-identical
+// results: values are clamped to the target range before they are rounded to
+// nearest even, and NaN is clamped to the lowest value.
+
+static inline float dequantize_scalar(int32_t q, float scale,
+                                      int32_t zero_point) {
+  return (float)(q - zero_point) * scale;
+}
+
+static inline int32_t quantize_scalar(float x, float inv_scale,
+                                      int32_t zero_point, float low,
+                                      float high) {
+  float v = x * inv_scale;
+  if (!(v >= low)) v = low;
+  if (v > high) v = high;
+  return (int32_t)lrintf(v) + zero_point;
+}
+
+static uint16_t float_to_half(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  uint32_t sign = (f >> 16) & 0x8000;
+  f &= 0x7fffffff;
+  uint16_t h;
+  if (f >= 0x47800000) {
+    // Too large for a half, infinity or NaN, whose payload is truncated and
+    // made quiet as F16C and NEON do.
+    h = f > 0x7f800000 ? (uint16_t)(0x7e00 | ((f >> 13) & 0x3ff)) : 0x7c00;
+  } else if (f < 0x38800000) {
+    // Subnormal half or zero: let the float addition round the mantissa.
+    float magic = 0.5f;
+    float rounded;
+    uint32_t bits;
+    memcpy(&rounded, &f, sizeof(rounded));
+    rounded += magic;
+    memcpy(&bits, &rounded, sizeof(bits));
+    h = (uint16_t)(bits - 0x3f000000);
+  } else {
+    uint32_t mantissa_odd = (f >> 13) & 1;
+    f += 0xc8000fff + mantissa_odd;  // Rebias the exponent, round to even
+    h = (uint16_t)(f >> 13);
+  }
+  return (uint16_t)(h | sign);
+}
+
+static float half_to_float(uint16_t h) {
+  uint32_t f = (uint32_t)(h & 0x7fff) << 13;
+  uint32_t exponent = f & 0x0f800000;
+  f += 0x38000000;  // Rebias the exponent
+  if (exponent == 0x0f800000) {
+    f += 0x38000000;  // Infinity or NaN
+    if (f & 0x007fffff) f |= 0x00400000;  // Quiet NaN, as F16C and NEON do
+  } else if (exponent == 0) {
+    // Subnormal half or zero: renormalize with a float subtraction.
+    float value;
+    f += 0x00800000;
+    memcpy(&value, &f, sizeof(value));
+    value -= 6.103515625e-05f;  // 2^-14
+    memcpy(&f, &value, sizeof(f));
+  }
+  f |= (uint32_t)(h & 0x8000) << 16;
+  float result;
+  memcpy(&result, &f, sizeof(result));
+  return result;
+}
+
+static uint16_t float_to_bfloat16(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  if ((f & 0x7fffffff) > 0x7f800000) {
+    return (uint16_t)((f >> 16) | 0x0040);  // Keep NaN quiet
+  }
+  f += 0x7fff + ((f >> 16) & 1);  // Round to nearest even
+  return (uint16_t)(f >> 16);
+}
+
+static float bfloat16_to_float(uint16_t b) {
+  uint32_t f = (uint32_t)b << 16;
+  float result;
+  memcpy(&result, &f, sizeof(result));
+  return result;
+}
+
+#if defined(TENSORS_SSE2)
+static size_t dequantize_sse2(const void* src, bool is_signed, float* dst,
+                              size_t count, float scale, int32_t zero_point) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i zp = _mm_set1_epi32(zero_point);
+  const __m128 s = _mm_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i bytes =
+        _mm_loadu_si128((const __m128i*)((const uint8_t*)src + i));
+    __m128i lo16;
+    __m128i hi16;
+    if (is_signed) {
+      lo16 = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+      hi16 = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+    } else {
+      lo16 = _mm_unpacklo_epi8(bytes, zero);
+      hi16 = _mm_unpackhi_epi8(bytes, zero);
+    }
+    __m128i q[4];
+    q[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo16, lo16), 16);
+    q[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo16, lo16), 16);
+    q[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi16, hi16), 16);
+    q[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi16, hi16), 16);
+    for (int j = 0; j < 4; ++j) {
+      __m128 v = _mm_cvtepi32_ps(_mm_sub_epi32(q[j], zp));
+      _mm_storeu_ps(dst + i + 4 * j, _mm_mul_ps(v, s));
+    }
+  }
+  return i;
+}
+
+static size_t quantize_sse2(const float* src, void* dst, bool is_signed,
+                            size_t count, float inv_scale, int32_t zero_point,
+                            float low, float high) {
+  const __m128 s = _mm_set1_ps(inv_scale);
+  const __m128 lo = _mm_set1_ps(low);
+  const __m128 hi = _mm_set1_ps(high);
+  const __m128i zp = _mm_set1_epi32(zero_point);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i q[4];
+    for (int j = 0; j < 4; ++j) {
+      __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i + 4 * j), s);
+      v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+      q[j] = _mm_add_epi32(_mm_cvtps_epi32(v), zp);
+    }
+    __m128i lo16 = _mm_packs_epi32(q[0], q[1]);
+    __m128i hi16 = _mm_packs_epi32(q[2], q[3]);
+    __m128i bytes = is_signed ? _mm_packs_epi16(lo16, hi16)
+                              : _mm_packus_epi16(lo16, hi16);
+    _mm_storeu_si128((__m128i*)((uint8_t*)dst + i), bytes);
+  }
+  return i;
+}
+
+static size_t float_to_bfloat16_sse2(const float* src, uint16_t* dst,
+                                     size_t count) {
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i bias = _mm_set1_epi32(0x7fff);
+  const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+  const __m128i infinity = _mm_set1_epi32(0x7f800000);
+  const __m128i quiet = _mm_set1_epi32(0x00400000);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i half[2];
+    for (int j = 0; j < 2; ++j) {
+      __m128i f = _mm_loadu_si128((const __m128i*)(src + i + 4 * j));
+      __m128i lsb = _mm_and_si128(_mm_srli_epi32(f, 16), one);
+      __m128i rounded = _mm_add_epi32(f, _mm_add_epi32(bias, lsb));
+      __m128i nan = _mm_cmpgt_epi32(_mm_and_si128(f, abs_mask), infinity);
+      rounded = _mm_or_si128(_mm_andnot_si128(nan, rounded),
+                             _mm_and_si128(nan, _mm_or_si128(f, quiet)));
+      // The arithmetic shift keeps the upper halves within the int16 range,
+      // so the signed pack leaves their bits unchanged.
+      half[j] = _mm_srai_epi32(rounded, 16);
+    }
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(half[0], half[1]));
+  }
+  return i;
+}
+
+static size_t bfloat16_to_float_sse2(const uint16_t* src, float* dst,
+                                     size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(zero, b));
+    _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(zero, b));
+  }
+  return i;
+}
+#endif  // TENSORS_SSE2
+
+#if defined(TENSORS_X86_DISPATCH)
+__attribute__((target("avx2"))) static size_t dequantize_avx2(
+    const void* src, bool is_signed, float* dst, size_t count, float scale,
+    int32_t zero_point) {
+  const __m256i zp = _mm256_set1_epi32(zero_point);
+  const __m256 s = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i bytes = _mm_loadl_epi64((const __m128i*)((const uint8_t*)src + i));
+    __m256i q = is_signed ? _mm256_cvtepi8_epi32(bytes)
+                          : _mm256_cvtepu8_epi32(bytes);
+    __m256 v = _mm256_cvtepi32_ps(_mm256_sub_epi32(q, zp));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(v, s));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t quantize_avx2(
+    const float* src, void* dst, bool is_signed, size_t count,
+    float inv_scale, int32_t zero_point, float low, float high) {
+  const __m256 s = _mm256_set1_ps(inv_scale);
+  const __m256 lo = _mm256_set1_ps(low);
+  const __m256 hi = _mm256_set1_ps(high);
+  const __m256i zp = _mm256_set1_epi32(zero_point);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i q[4];
+    for (int j = 0; j < 4; ++j) {
+      __m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8 * j), s);
+      v = _mm256_min_ps(_mm256_max_ps(v, lo), hi);
+      q[j] = _mm256_add_epi32(_mm256_cvtps_epi32(v), zp);
+    }
+    // The packs work per 128-bit lane, the permutation restores the order.
+    __m256i lo16 = _mm256_packs_epi32(q[0], q[1]);
+    __m256i hi16 = _mm256_packs_epi32(q[2], q[3]);
+    __m256i bytes = is_signed ? _mm256_packs_epi16(lo16, hi16)
+                              : _mm256_packus_epi16(lo16, hi16);
+    bytes = _mm256_permutevar8x32_epi32(bytes, order);
+    _mm256_storeu_si256((__m256i*)((uint8_t*)dst + i), bytes);
+  }
+  return i;
+}
+
+__attribute__((target("avx,f16c"))) static size_t float_to_half_f16c(
+    const float* src, uint16_t* dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i*)(dst + i), h);
+  }
+  return i;
+}
+
+__attribute__((target("avx,f16c"))) static size_t half_to_float_f16c(
+    const uint16_t* src, float* dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  return i;
+}
+
+// GCC and Clang check that the OS saves the AVX registers before reporting
+// AVX2, and every AVX2 CPU also implements F16C.
+static bool cpu_has_avx2(void) { return __builtin_cpu_supports("avx2"); }
+
+static bool cpu_has_f16c(void) {
+  static int supported = -1;
+  int cached = __atomic_load_n(&supported, __ATOMIC_RELAXED);
+  if (cached < 0) {
+    unsigned int eax;
+    unsigned int ebx;
+    unsigned int ecx;
+    unsigned int edx;
+    cached = cpu_has_avx2() && __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+             (ecx & bit_F16C) != 0;
+    __atomic_store_n(&supported, cached, __ATOMIC_RELAXED);
+  }
+  return cached == 1;
+}
+#endif  // TENSORS_X86_DISPATCH
+
+#if defined(TENSORS_NEON)
+static size_t dequantize_neon(const void* src, bool is_signed, float* dst,
+                              size_t count, float scale, int32_t zero_point) {
+  const int32x4_t zp = vdupq_n_s32(zero_point);
+  const float32x4_t s = vdupq_n_f32(scale);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t q16;
+    if (is_signed) {
+      q16 = vmovl_s8(vld1_s8((const int8_t*)src + i));
+    } else {
+      q16 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8((const uint8_t*)src + i)));
+    }
+    int32x4_t lo = vsubq_s32(vmovl_s16(vget_low_s16(q16)), zp);
+    int32x4_t hi = vsubq_s32(vmovl_s16(vget_high_s16(q16)), zp);
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(lo), s));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(hi), s));
+  }
+  return i;
+}
+
+static size_t quantize_neon(const float* src, void* dst, bool is_signed,
+                            size_t count, float inv_scale, int32_t zero_point,
+                            float low, float high) {
+  const float32x4_t s = vdupq_n_f32(inv_scale);
+  const float32x4_t lo = vdupq_n_f32(low);
+  const float32x4_t hi = vdupq_n_f32(high);
+  const int32x4_t zp = vdupq_n_s32(zero_point);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int32x4_t q[2];
+    for (int j = 0; j < 2; ++j) {
+      float32x4_t v = vmulq_f32(vld1q_f32(src + i + 4 * j), s);
+      // vmaxnm returns the number when one operand is NaN, like the scalar
+      // path, which clamps NaN to the lowest value.
+      v = vminq_f32(vmaxnmq_f32(v, lo), hi);
+      q[j] = vaddq_s32(vcvtnq_s32_f32(v), zp);
+    }
+    int16x8_t q16 = vcombine_s16(vmovn_s32(q[0]), vmovn_s32(q[1]));
+    if (is_signed) {
+      vst1_s8((int8_t*)dst + i, vmovn_s16(q16));
+    } else {
+      vst1_u8((uint8_t*)dst + i, vqmovun_s16(q16));
+    }
+  }
+  return i;
+}
+
+static size_t float_to_half_neon(const float* src, uint16_t* dst,
+                                 size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vcvt_f16_f32(vld1q_f32(src + i));
+    vst1_u16(dst + i, vreinterpret_u16_f16(h));
+  }
+  return i;
+}
+
+static size_t half_to_float_neon(const uint16_t* src, float* dst,
+                                 size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vreinterpret_f16_u16(vld1_u16(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(h));
+  }
+  return i;
+}
+
+static size_t float_to_bfloat16_neon(const float* src, uint16_t* dst,
+                                     size_t count) {
+  const uint32x4_t one = vdupq_n_u32(1);
+  const uint32x4_t bias = vdupq_n_u32(0x7fff);
+  const uint32x4_t abs_mask = vdupq_n_u32(0x7fffffff);
+  const uint32x4_t infinity = vdupq_n_u32(0x7f800000);
+  const uint32x4_t quiet = vdupq_n_u32(0x00400000);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t f = vld1q_u32((const uint32_t*)(src + i));
+    uint32x4_t lsb = vandq_u32(vshrq_n_u32(f, 16), one);
+    uint32x4_t rounded = vaddq_u32(f, vaddq_u32(bias, lsb));
+    uint32x4_t nan = vcgtq_u32(vandq_u32(f, abs_mask), infinity);
+    rounded = vbslq_u32(nan, vorrq_u32(f, quiet), rounded);
+    vst1_u16(dst + i, vshrn_n_u32(rounded, 16));
+  }
+  return i;
+}
+
+static size_t bfloat16_to_float_neon(const uint16_t* src, float* dst,
+                                     size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t f = vshll_n_u16(vld1_u16(src + i), 16);
+    vst1q_f32(dst + i, vreinterpretq_f32_u32(f));
+  }
+  return i;
+}
+#endif  // TENSORS_NEON
+
+static void dequantize(const void* src, bool is_signed, float* dst,
+                       size_t count, float scale, int32_t zero_point) {
+  size_t i = 0;
+#if defined(TENSORS_X86_DISPATCH)
+  if (cpu_has_avx2()) {
+    i = dequantize_avx2(src, is_signed, dst, count, scale, zero_point);
+  }
+#endif
+#if defined(TENSORS_SSE2)
+  i += dequantize_sse2((const uint8_t*)src + i, is_signed, dst + i, count - i,
+                       scale, zero_point);
+#elif defined(TENSORS_NEON)
+  i = dequantize_neon(src, is_signed, dst, count, scale, zero_point);
+#endif
+  for (; i < count; ++i) {
+    int32_t q = is_signed ? ((const int8_t*)src)[i] : ((const uint8_t*)src)[i];
+    dst[i] = dequantize_scalar(q, scale, zero_point);
+  }
+}
+
+static void quantize(const float* src, void* dst, bool is_signed,
+                     size_t count, float scale, int32_t zero_point) {
+  const float inv_scale = 1.0f / scale;
+  // Clamp in the float domain, so the rounded value plus the zero point is
+  // always representable in the destination type.
+  const float low = (float)((is_signed ? INT8_MIN : 0) - zero_point);
+  const float high = (float)((is_signed ? INT8_MAX : UINT8_MAX) - zero_point);
+  size_t i = 0;
+#if defined(TENSORS_X86_DISPATCH)
+  if (cpu_has_avx2()) {
+    i = quantize_avx2(src, dst, is_signed, count, inv_scale, zero_point, low,
+                      high);
+  }
+#endif
+#if defined(TENSORS_SSE2)
+  i += quantize_sse2(src + i, (uint8_t*)dst + i, is_signed, count - i,
+                     inv_scale, zero_point, low, high);
+#elif defined(TENSORS_NEON)
+  i = quantize_neon(src, dst, is_signed, count, inv_scale, zero_point, low,
+                    high);
+#endif
+  for (; i < count; ++i) {
+    int32_t q = quantize_scalar(src[i], inv_scale, zero_point, low, high);
+    if (is_signed) {
+      ((int8_t*)dst)[i] = (int8_t)q;
+    } else {
+      ((uint8_t*)dst)[i] = (uint8_t)q;
+    }
+  }
+}
+
+static void convert_float_to_half(const float* src, uint16_t* dst,
+                                  size_t count) {
+  size_t i = 0;
+#if defined(TENSORS_X86_DISPATCH)
+  if (cpu_has_f16c()) {
+    i = float_to_half_f16c(src, dst, count);
+  }
+#elif defined(TENSORS_NEON)
+  i = float_to_half_neon(src, dst, count);
+#endif
+  for (; i < count; ++i) {
+    dst[i] = float_to_half(src[i]);
+  }
+}
+
+static void convert_half_to_float(const uint16_t* src, float* dst,
+                                  size_t count) {
+  size_t i = 0;
+#if defined(TENSORS_X86_DISPATCH)
+  if (cpu_has_f16c()) {
+    i = half_to_float_f16c(src, dst, count);
+  }
+#elif defined(TENSORS_NEON)
+  i = half_to_float_neon(src, dst, count);
+#endif
+  for (; i < count; ++i) {
+    dst[i] = half_to_float(src[i]);
+  }
+}
+
+static void convert_float_to_bfloat16(const float* src, uint16_t* dst,
+                                      size_t count) {
+  size_t i = 0;
+#if defined(TENSORS_SSE2)
+  i = float_to_bfloat16_sse2(src, dst, count);
+#elif defined(TENSORS_NEON)
+  i = float_to_bfloat16_neon(src, dst, count);
+#endif
+  for (; i < count; ++i) {
+    dst[i] = float_to_bfloat16(src[i]);
+  }
+}
+
+static void convert_bfloat16_to_float(const uint16_t* src, float* dst,
+                                      size_t count) {
+  size_t i = 0;
+#if defined(TENSORS_SSE2)
+  i = bfloat16_to_float_sse2(src, dst, count);
+#elif defined(TENSORS_NEON)
+  i = bfloat16_to_float_neon(src, dst, count);
+#endif
+  for (; i < count; ++i) {
+    dst[i] = bfloat16_to_float(src[i]);
+  }
+}
+
+// Converts between float16 and bfloat16 through float, one cache-resident
+// block at a time. Both have the same size, so dst may be src.
+static void convert_half_to_half(const uint16_t* src, bool src_bfloat16,
+                                 uint16_t* dst, size_t count) {
+  float block[256];
+  for (size_t i = 0; i < count; i += 256) {
+    size_t n = count - i < 256 ? count - i : 256;
+    if (src_bfloat16) {
+      convert_bfloat16_to_float(src + i, block, n);
+      convert_float_to_half(block, dst + i, n);
+    } else {
+      convert_half_to_float(src + i, block, n);
+      convert_float_to_bfloat16(block, dst + i, n);
+    }
+  }
+}
+
+static size_t conversion_element_size(tensor_data_type type) {
+  switch (type) {
+    case DATA_TYPE_FLOAT:
+      return sizeof(float);
+    case DATA_TYPE_FLOAT16:
+    case DATA_TYPE_BFLOAT16:
+      return sizeof(uint16_t);
+    case DATA_TYPE_INT8:
+    case DATA_TYPE_UINT8:
+      return sizeof(uint8_t);
+    default:
+      return 0;
+  }
+}
+
+int convert_tensor_dtype(const void* src, tensor_data_type src_type,
+                         void* dst, tensor_data_type dst_type, size_t count,
+                         float scale, int32_t zero_point) {
+  size_t src_size = conversion_element_size(src_type);
+  size_t dst_size = conversion_element_size(dst_type);
+  if (src_size == 0 || dst_size == 0) {
+    printf("Error: Unsupported conversion from data type %d to %d\n",
+           src_type, dst_type);
+    return -1;
+  }
+  // Elements are converted front to back, so the destination may only start
+  // at the source when it does not grow.
+  const uint8_t* s = (const uint8_t*)src;
+  uint8_t* d = (uint8_t*)dst;
+  if (count > 0 && d != s && d < s + count * src_size &&
+      s < d + count * dst_size) {
+    printf("Error: Overlapping conversion buffers\n");
+    return -1;
+  }
+  if (d == s && dst_size > src_size) {
+    printf("Error: In-place conversion to a larger data type\n");
+    return -1;
+  }
+
+  if (src_type == dst_type) {
+    if (d != s) memcpy(d, s, count * src_size);
+    return 0;
+  }
+  bool src_quantized =
+      src_type == DATA_TYPE_INT8 || src_type == DATA_TYPE_UINT8;
+  bool dst_quantized =
+      dst_type == DATA_TYPE_INT8 || dst_type == DATA_TYPE_UINT8;
+  if ((src_quantized || dst_quantized) && !(scale > 0.0f)) {
+    printf("Error: Invalid quantization scale %f\n", scale);
+    return -1;
+  }
+
+  if (src_quantized && dst_type == DATA_TYPE_FLOAT) {
+    dequantize(src, src_type == DATA_TYPE_INT8, (float*)dst, count, scale,
+               zero_point);
+  } else if (src_type == DATA_TYPE_FLOAT && dst_quantized) {
+    quantize((const float*)src, dst, dst_type == DATA_TYPE_INT8, count, scale,
+             zero_point);
+  } else if (src_type == DATA_TYPE_FLOAT && dst_type == DATA_TYPE_FLOAT16) {
+    convert_float_to_half((const float*)src, (uint16_t*)dst, count);
+  } else if (src_type == DATA_TYPE_FLOAT16 && dst_type == DATA_TYPE_FLOAT) {
+    convert_half_to_float((const uint16_t*)src, (float*)dst, count);
+  } else if (src_type == DATA_TYPE_FLOAT && dst_type == DATA_TYPE_BFLOAT16) {
+    convert_float_to_bfloat16((const float*)src, (uint16_t*)dst, count);
+  } else if (src_type == DATA_TYPE_BFLOAT16 && dst_type == DATA_TYPE_FLOAT) {
+    convert_bfloat16_to_float((const uint16_t*)src, (float*)dst, count);
+  } else if (src_size == sizeof(uint16_t) && dst_size == sizeof(uint16_t)) {
+    convert_half_to_half((const uint16_t*)src, src_type == DATA_TYPE_BFLOAT16,
+                         (uint16_t*)dst, count);
+  } else {
+    printf("Error: Unsupported conversion from data type %d to %d\n",
+           src_type, dst_type);
+    return -1;
+  }
+  return 0;
+}
+
 void print_tensors_metadata(const tensors_struct* tensors) {
   // Print number of tensors
   printf("Number of tensors: %zu\n", tensors->num_tensors);
@@ -93,11 +827,11 @@ void deep_free_tensors_struct(tensors_struct* tensors) {
     for (size_t i = 0; i < tensors->num_tensors; ++i) {
       // Free the name of the tensor if not NULL
       if (tensors->names[i] != NULL) {
-        free(tensors->names[i]);
+        tensors_free(tensors->names[i]);
       }
     }
     // Free the names array
-    free(tensors->names);
+    tensors_free(tensors->names);
   } else {
     // Print a warning if names is NULL
     printf("Warning: names array is NULL\n");
@@ -109,11 +843,11 @@ void deep_free_tensors_struct(tensors_struct* tensors) {
     for (size_t i = 0; i < tensors->num_tensors; ++i) {
       // Free the shape array of each tensor if not NULL
       if (tensors->shapes[i] != NULL) {
-        free(tensors->shapes[i]);
+        tensors_free(tensors->shapes[i]);
       }
     }
     // Free the shapes array
-    free(tensors->shapes);
+    tensors_free(tensors->shapes);
   } else {
     // Print a warning if shapes is NULL
     printf("Warning: shapes array is NULL\n");
@@ -125,11 +859,11 @@ void deep_free_tensors_struct(tensors_struct* tensors) {
     for (size_t i = 0; i < tensors->num_tensors; ++i) {
       // Free the data of each tensor if not NULL
       if (tensors->data[i] != NULL) {
-        free(tensors->data[i]);
+        tensors_free(tensors->data[i]);
       }
     }
     // Free the data array
-    free(tensors->data);
+    tensors_free(tensors->data);
   } else {
     // Print a warning if data is NULL
     printf("Warning: data array is NULL\n");
@@ -138,7 +872,7 @@ void deep_free_tensors_struct(tensors_struct* tensors) {
   // Check if the data_types array is NULL
   if (tensors->data_types != NULL) {
     // Free the data_types array
-    free(tensors->data_types);
+    tensors_free(tensors->data_types);
   } else {
     // Print a warning if data_types is NULL
     printf("Warning: data_types array is NULL\n");
@@ -147,14 +881,14 @@ void deep_free_tensors_struct(tensors_struct* tensors) {
   // Check if the ranks array is NULL
   if (tensors->ranks != NULL) {
     // Free the ranks array
-    free(tensors->ranks);
+    tensors_free(tensors->ranks);
   } else {
     // Print a warning if ranks is NULL
     printf("Warning: ranks array is NULL\n");
   }
 
   // Free the tensors struct itself
-  free(tensors);
+  tensors_free(tensors);
 }
 
 void shallow_free_tensors_struct(tensors_struct* tensors) {
@@ -166,7 +900,7 @@ void shallow_free_tensors_struct(tensors_struct* tensors) {
   // check if the names array is NULL
   if (tensors->names != NULL) {
     // Free the names array
-    free(tensors->names);
+    tensors_free(tensors->names);
   } else {
     // Print a warning if names is NULL
     printf("Warning: names array is NULL\n");
@@ -175,7 +909,7 @@ void shallow_free_tensors_struct(tensors_struct* tensors) {
   // Check if the shapes array is NULL
   if (tensors->shapes != NULL) {
     // Free the shapes array
-    free(tensors->shapes);
+    tensors_free(tensors->shapes);
   } else {
     // Print a warning if shapes is NULL
     printf("Warning: shapes array is NULL\n");
@@ -184,7 +918,7 @@ void shallow_free_tensors_struct(tensors_struct* tensors) {
   // Check if the data array is NULL
   if (tensors->data != NULL) {
     // Free the data array
-    free(tensors->data);
+    tensors_free(tensors->data);
   } else {
     // Print a warning if data is NULL
     printf("Warning: data array is NULL\n");
@@ -193,7 +927,7 @@ void shallow_free_tensors_struct(tensors_struct* tensors) {
   // Check if the data_types array is NULL
   if (tensors->data_types != NULL) {
     // Free the data_types array
-    free(tensors->data_types);
+    tensors_free(tensors->data_types);
   } else {
     // Print a warning if data_types is NULL
     printf("Warning: data_types array is NULL\n");
@@ -202,14 +936,14 @@ void shallow_free_tensors_struct(tensors_struct* tensors) {
   // Check if the ranks array is NULL
   if (tensors->ranks != NULL) {
     // Free the ranks array
-    free(tensors->ranks);
+    tensors_free(tensors->ranks);
   } else {
     // Print a warning if ranks is NULL
     printf("Warning: ranks array is NULL\n");
   }
 
   // Free the tensors struct itself
-  free(tensors);
+  tensors_free(tensors);
 }
 
 tensors_struct* deep_copy_tensors_struct(const tensors_struct* src) {
@@ -220,7 +954,7 @@ tensors_struct* deep_copy_tensors_struct(const tensors_struct* src) {
   }
 
   // Allocate memory for the new tensors_struct
-  tensors_struct* dst = (tensors_struct*)malloc(sizeof(tensors_struct));
+  tensors_struct* dst = (tensors_struct*)tensors_malloc(sizeof(tensors_struct));
   if (dst == NULL) {
     printf("Error: Memory allocation failed for tensors_struct\n");
     return NULL;
@@ -230,56 +964,57 @@ tensors_struct* deep_copy_tensors_struct(const tensors_struct* src) {
   dst->num_tensors = src->num_tensors;
 
   // Allocate memory for names
-  dst->names = (char**)malloc(dst->num_tensors * sizeof(char*));
+  dst->names = (char**)tensors_malloc(dst->num_tensors * sizeof(char*));
   if (dst->names == NULL) {
     printf("Error: Memory allocation failed for names\n");
-    free(dst);
+    tensors_free(dst);
     return NULL;
   }
   // Allocate memory for data_types
   dst->data_types =
-      (tensor_data_type*)malloc(dst->num_tensors * sizeof(tensor_data_type));
+      (tensor_data_type*)tensors_malloc(dst->num_tensors *
+                                        sizeof(tensor_data_type));
   if (dst->data_types == NULL) {
     printf("Error: Memory allocation failed for data_types\n");
-    free(dst->names);
-    free(dst);
+    tensors_free(dst->names);
+    tensors_free(dst);
     return NULL;
   }
 
   // Allocate memory for ranks
-  dst->ranks = (size_t*)malloc(dst->num_tensors * sizeof(size_t));
+  dst->ranks = (size_t*)tensors_malloc(dst->num_tensors * sizeof(size_t));
   if (dst->ranks == NULL) {
     printf("Error: Memory allocation failed for ranks\n");
-    free(dst->data_types);
-    free(dst->names);
-    free(dst);
+    tensors_free(dst->data_types);
+    tensors_free(dst->names);
+    tensors_free(dst);
     return NULL;
   }
   // Allocate memory for shapes
-  dst->shapes = (size_t**)malloc(dst->num_tensors * sizeof(size_t*));
+  dst->shapes = (size_t**)tensors_malloc(dst->num_tensors * sizeof(size_t*));
   if (dst->shapes == NULL) {
     printf("Error: Memory allocation failed for shapes\n");
-    free(dst->ranks);
-    free(dst->data_types);
-    free(dst->names);
-    free(dst);
+    tensors_free(dst->ranks);
+    tensors_free(dst->data_types);
+    tensors_free(dst->names);
+    tensors_free(dst);
     return NULL;
   }
   // Allocate memory for data
-  dst->data = (void**)malloc(dst->num_tensors * sizeof(void*));
+  dst->data = (void**)tensors_malloc(dst->num_tensors * sizeof(void*));
   if (dst->data == NULL) {
     printf("Error: Memory allocation failed for data\n");
-    free(dst->shapes);
-    free(dst->ranks);
-    free(dst->data_types);
-    free(dst->names);
-    free(dst);
+    tensors_free(dst->shapes);
+    tensors_free(dst->ranks);
+    tensors_free(dst->data_types);
+    tensors_free(dst->names);
+    tensors_free(dst);
     return NULL;
   }
   // Iterate through each tensor
   for (size_t i = 0; i < dst->num_tensors; ++i) {
     // Copy the name of the tensor
-    dst->names[i] = strdup(src->names[i]);
+    dst->names[i] = tensors_strdup(src->names[i]);
 
     // Copy the data type
     dst->data_types[i] = src->data_types[i];
@@ -288,7 +1023,7 @@ tensors_struct* deep_copy_tensors_struct(const tensors_struct* src) {
     dst->ranks[i] = src->ranks[i];
 
     // Allocate memory for shapes
-    dst->shapes[i] = (size_t*)malloc(src->ranks[i] * sizeof(size_t));
+    dst->shapes[i] = (size_t*)tensors_malloc(src->ranks[i] * sizeof(size_t));
     // Copy the shape
     memcpy(dst->shapes[i], src->shapes[i], src->ranks[i] * sizeof(size_t));
 
@@ -298,7 +1033,7 @@ tensors_struct* deep_copy_tensors_struct(const tensors_struct* src) {
     for (size_t j = 0; j < src->ranks[i]; ++j) {
       total_size *= src->shapes[i][j];
     }
-    dst->data[i] = malloc(total_size);
+    dst->data[i] = tensors_malloc(total_size);
     // Copy the data
     memcpy(dst->data[i], src->data[i], total_size);
   }
@@ -398,34 +1133,36 @@ tensors_struct* create_sample_tensors_struct(int seed) {
     seed = 0;
   }
   // Create a sample tensors_struct with dummy data
-  tensors_struct* t = (tensors_struct*)malloc(sizeof(tensors_struct));
+  tensors_struct* t = (tensors_struct*)tensors_malloc(sizeof(tensors_struct));
   if (t == NULL) {
     printf("Error: Memory allocation failed for tensors_struct\n");
     return NULL;
   }
   t->num_tensors = 2;
-  t->names = (char**)malloc(2 * sizeof(char*));
-  t->names[0] = strdup("tensor1");
-  t->names[1] = strdup("tensor2");
+  t->names = (char**)tensors_malloc(2 * sizeof(char*));
+  t->names[0] = tensors_strdup("tensor1");
+  t->names[1] = tensors_strdup("tensor2");
 
-  t->data_types = (tensor_data_type*)malloc(2 * sizeof(tensor_data_type));
+  t->data_types =
+      (tensor_data_type*)tensors_malloc(2 * sizeof(tensor_data_type));
   t->data_types[0] = DATA_TYPE_FLOAT;
   t->data_types[1] = DATA_TYPE_INT32;
 
-  t->ranks = (size_t*)malloc(2 * sizeof(size_t));
+  t->ranks = (size_t*)tensors_malloc(2 * sizeof(size_t));
   t->ranks[0] = 2;
   t->ranks[1] = 1;
 
-  t->shapes = (size_t**)malloc(2 * sizeof(size_t*));
-  t->shapes[0] = (size_t*)malloc(2 * sizeof(size_t));
+  t->shapes = (size_t**)tensors_malloc(2 * sizeof(size_t*));
+  t->shapes[0] = (size_t*)tensors_malloc(2 * sizeof(size_t));
   t->shapes[0][0] = 1 + 2 * seed;
   t->shapes[0][1] = 3 + seed;
-  t->shapes[1] = (size_t*)malloc(1 * sizeof(size_t));
+  t->shapes[1] = (size_t*)tensors_malloc(1 * sizeof(size_t));
   t->shapes[1][0] = 5 + 2 * seed;
 
-  t->data = (void**)malloc(2 * sizeof(void*));
-  t->data[0] = malloc(t->shapes[0][0] * t->shapes[0][1] * sizeof(float));
-  t->data[1] = malloc(t->shapes[1][0] * sizeof(int32_t));
+  t->data = (void**)tensors_malloc(2 * sizeof(void*));
+  t->data[0] =
+      tensors_malloc(t->shapes[0][0] * t->shapes[0][1] * sizeof(float));
+  t->data[1] = tensors_malloc(t->shapes[1][0] * sizeof(int32_t));
   float* d0 = (float*)t->data[0];
   for (size_t i = 0; i < t->shapes[0][0] * t->shapes[0][1]; ++i)
     d0[i] = (float)i * seed / 10.34343f;
@@ -0,0 +1,205 @@
+#ifndef RUNTIME_ASYNC_HPP
+#define RUNTIME_ASYNC_HPP
+
+#include "runtime_core.h"
+#include "runtime_tensors.hpp"
+
+#include <stdint.h>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#  if __has_include(<coroutine>)
+#    include <coroutine>
+#    define RUNTIME_ASYNC_COROUTINES 1
+#  endif
+#endif
+
+/**
+ * Header-only C++ wrapper running inferences as futures or, with C++20, as co_await-able operations.
+ *
+ * Every request is sent with send_input_tagged, tagged with the address of its completion state, and
+ * completed from the output callback, so requests need no queue of their own and can be in flight by the
+ * thousands. Requests complete on the runtime's delivery threads (or pipeline workers); continuations of
+ * futures run wherever get() is called, coroutines are resumed on the delivery thread.
+ *
+ *     runtime_initialization_with_args(length, keys, values);
+ *     oaax::AsyncRuntime runtime;
+ *     runtime.load("model.dxnn");
+ *     std::future<oaax::Tensors> outputs = runtime.infer_async(std::move(inputs));
+ */
+namespace oaax {
+
+class InferenceError : public std::runtime_error {
+public:
+    InferenceError(const std::string &what, int status) : std::runtime_error(what), status_(status) {}
+
+    int status() const { return status_; }
+
+private:
+    int status_;
+};
+
+namespace detail {
+
+// One request in flight; its address is the tag it is sent with.
+struct Request {
+    virtual ~Request() = default;
+    virtual void complete(int status, tensors_struct *outputs) = 0;
+};
+
+inline uint64_t tag_of(Request *request) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(request));
+}
+
+// Hands the inputs to the runtime, which owns them from then on. They stay with the caller on failure.
+// The request may complete, and be destroyed, before this returns.
+inline int send(Tensors &inputs, Request *request) {
+    tensors_struct *raw = inputs.release();
+    int status = ::send_input_tagged(raw, tag_of(request));
+    if (status != 0) {
+        inputs.reset(raw);
+    }
+    return status;
+}
+
+struct FutureRequest : Request {
+    std::promise<Tensors> promise;
+
+    void complete(int status, tensors_struct *outputs) override {
+        if (status == 0) {
+            promise.set_value(Tensors(outputs));
+        } else {
+            promise.set_exception(std::make_exception_ptr(InferenceError("Inference failed", status)));
+        }
+        delete this;
+    }
+};
+
+} // namespace detail
+
+#if defined(RUNTIME_ASYNC_COROUTINES)
+/**
+ * One inference, sent when it is awaited. co_await yields the outputs or throws InferenceError.
+ */
+class InferOperation : private detail::Request {
+public:
+    explicit InferOperation(Tensors inputs) : inputs_(std::move(inputs)) {}
+
+    InferOperation(const InferOperation &) = delete;
+    InferOperation &operator=(const InferOperation &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        int status = detail::send(inputs_, this);
+        if (status != 0) {
+            status_ = status;
+            return false;
+        }
+        // The coroutine may already have been resumed, and this operation destroyed.
+        return true;
+    }
+
+    Tensors await_resume() {
+        if (status_ != 0) {
+            throw InferenceError(sent_ ? "Inference failed" : "The input could not be sent", status_);
+        }
+        return std::move(outputs_);
+    }
+
+private:
+    void complete(int status, tensors_struct *outputs) override {
+        sent_ = true;
+        status_ = status;
+        outputs_.reset(outputs);
+        handle_.resume();
+    }
+
+    Tensors inputs_;
+    Tensors outputs_;
+    std::coroutine_handle<> handle_;
+    int status_ = 0;
+    bool sent_ = false;
+};
+#endif
+
+/**
+ * Registers the output callback for the lifetime of the object and destroys the runtime with it.
+ *
+ * Once constructed, every input must be sent through it: outputs of inputs sent with send_input are
+ * dropped, and receive_output no longer returns anything.
+ */
+class AsyncRuntime {
+public:
+    /**
+     * Must be constructed after the runtime is initialized and before the model is loaded.
+     */
+    AsyncRuntime() {
+        if (runtime_set_output_callback(&AsyncRuntime::on_output, nullptr) != 0) {
+            throw InferenceError("The output callback must be registered before the model is loaded", 1);
+        }
+    }
+
+    /**
+     * Destroys the runtime. Requests already submitted to the device complete first, the others fail.
+     */
+    ~AsyncRuntime() { runtime_destruction(); }
+
+    AsyncRuntime(const AsyncRuntime &) = delete;
+    AsyncRuntime &operator=(const AsyncRuntime &) = delete;
+
+    void load(const char *model_path) {
+        int status = runtime_model_loading(model_path);
+        if (status != 0) {
+            throw InferenceError(std::string("Failed to load the model ") + model_path, status);
+        }
+    }
+
+    /**
+     * Sends the inputs, taking their ownership. Blocks while the runtime applies back-pressure.
+     *
+     * @return The outputs, or an InferenceError if the input could not be sent or the inference failed.
+     */
+    std::future<Tensors> infer_async(Tensors inputs) {
+        std::unique_ptr<detail::FutureRequest> request(new detail::FutureRequest());
+        std::future<Tensors> outputs = request->promise.get_future();
+        int status = detail::send(inputs, request.get());
+        if (status != 0) {
+            request->promise.set_exception(
+                std::make_exception_ptr(InferenceError("The input could not be sent", status)));
+            return outputs;
+        }
+        request.release();
+        return outputs;
+    }
+
+#if defined(RUNTIME_ASYNC_COROUTINES)
+    /**
+     * @return An operation that sends the inputs when awaited and resumes the awaiting coroutine on a
+     *         delivery thread.
+     */
+    InferOperation infer(Tensors inputs) { return InferOperation(std::move(inputs)); }
+#endif
+
+private:
+    static void on_output(int status, tensors_struct *outputs, uint64_t tag, void *) {
+        detail::Request *request = reinterpret_cast<detail::Request *>(static_cast<uintptr_t>(tag));
+        if (request == nullptr) {
+            // Sent around the wrapper.
+            if (outputs != nullptr) deep_free_tensors_struct(outputs);
+            return;
+        }
+        request->complete(status, outputs);
+    }
+};
+
+} // namespace oaax
+
+#endif // RUNTIME_ASYNC_HPP
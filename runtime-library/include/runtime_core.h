@@ -16,6 +16,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 extern "C" {
 #include "tensors_struct.h"
@@ -56,7 +57,11 @@ RUNTIME_API int runtime_model_loading(const char *file_path);
  * @note This function copies the reference of the input tensors, not the tensors themselves. 
  * The runtime will free the memory of the input tensors after its processed.
  * 
+ * @note When the "input_staging" argument is enabled, the input is copied into a runtime-owned staging buffer
+ * and freed as soon as the copy is done, rather than when the inference completes.
+ * 
  * @warning If this function returns a non-zero value, the caller is expected to free the memory of the input tensors.
+ * This includes a failure to start the inference, where earlier versions of the runtime freed them.
  *
  * @param tensors The input tensors for the inference processing. 
  * 
@@ -64,6 +69,165 @@ RUNTIME_API int runtime_model_loading(const char *file_path);
  */
 RUNTIME_API int send_input(tensors_struct *input_tensors);
 
+/**
+ * @brief Same as send_input, with a tag that is handed back to the output callback with the outputs.
+ *
+ * The tag lets callers match outputs to their requests when callbacks run concurrently on several
+ * delivery threads. Outputs of send_input and send_input_fd carry the tag 0. Tags are not visible
+ * through receive_output.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param input_tensors The input tensors for the inference processing.
+ * @param tag The caller's correlation tag.
+ *
+ * @return 0 if the input tensors are stored successfully, and non-zero otherwise.
+ */
+RUNTIME_API int send_input_tagged(tensors_struct *input_tensors, uint64_t tag);
+
+/**
+ * @brief Same as send_input_tagged, with a priority class and a deadline deciding when the input is admitted.
+ *
+ * Scheduled inputs wait in a queue ahead of the device and are submitted as output buffers become free,
+ * highest priority class first and earliest deadline first within a class, instead of in call order. Inputs
+ * without a deadline come after those with one in the same class, in call order. Outputs are returned in the
+ * order the inputs are admitted. Inputs sent with send_input are submitted directly and are not ordered
+ * against scheduled ones.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param input_tensors The input tensors for the inference processing.
+ * @param tag The caller's correlation tag.
+ * @param priority The priority class; higher classes are admitted first. Inputs sent with
+ *                 runtime_stream_send_input are in class 0.
+ * @param deadline_us The absolute deadline on runtime_clock_us(), or 0 for none.
+ *
+ * @return 0 if the input tensors are stored successfully, and non-zero otherwise.
+ */
+RUNTIME_API int send_input_scheduled(tensors_struct *input_tensors, uint64_t tag, int priority, uint64_t deadline_us);
+
+/**
+ * @brief Returns the current time of the clock submission deadlines refer to, in microseconds.
+ *
+ * @note This function is an extension to the OAAX interface.
+ */
+RUNTIME_API uint64_t runtime_clock_us();
+
+/**
+ * @brief Runs one inference synchronously on the calling thread.
+ *
+ * The input is submitted and its outputs collected without going through the queues and threads used by
+ * send_input and receive_output, which saves their wakeups for request/response callers. The call can be
+ * used concurrently with itself and with the asynchronous functions; it does not affect the outputs
+ * returned by receive_output.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param input_tensors The input tensors, which remain owned by the caller.
+ * @param output_tensors If *output_tensors is NULL, it receives newly allocated output tensors, as returned by
+ *                       receive_output. Otherwise the outputs are written into the data buffers of the given
+ *                       tensors, which must match the selected outputs in number, type and shape; no memory is
+ *                       allocated then. A postprocess stage always returns newly allocated tensors.
+ *
+ * @return 0 if the inference succeeded, and non-zero otherwise.
+ */
+RUNTIME_API int runtime_infer(const tensors_struct *input_tensors, tensors_struct **output_tensors);
+
+/**
+ * @brief Callback invoked once the runtime no longer reads an input buffer.
+ *
+ * @param user_ctx The user context given with the input.
+ */
+typedef void (*input_release_callback)(void *user_ctx);
+
+/**
+ * @brief This function is called to submit a file-descriptor-backed input buffer (e.g. a memfd or a dma-buf) without copying it.
+ *
+ * @note This function is an extension to the OAAX interface, and is only supported on Linux.
+ *
+ * @note The buffer is mapped read-only once and the mapping is cached by file identity, so buffers of a recycled pool
+ * are not mapped again. The runtime keeps its own reference to the file, so the caller may close the fd right away.
+ *
+ * @warning If this function returns a non-zero value, the release callback is not invoked.
+ *
+ * @param fd The file descriptor of the buffer.
+ * @param offset The offset of the input tensor data in the buffer.
+ * @param size The size of the input tensor data, at least the model input size.
+ * @param release Callback invoked, instead of freeing the input, once the inference no longer needs the buffer,
+ *                i.e. right after the staging copy when "input_staging" is enabled. May be NULL.
+ * @param user_ctx The user context passed to the release callback.
+ *
+ * @return 0 if the input is submitted successfully, and non-zero otherwise.
+ */
+RUNTIME_API int send_input_fd(int fd, size_t offset, size_t size, input_release_callback release, void *user_ctx);
+
+/**
+ * @brief This function is called to select the output tensors returned by receive_output for the inputs sent afterwards.
+ *
+ * @note This function is an extension to the OAAX interface.
+ * @note Outputs that are not selected are neither allocated nor copied. Inputs already sent keep the selection that was
+ * active when they were sent. The selected outputs are returned in model order.
+ *
+ * @param output_names A comma-separated list of output tensor names, or NULL or an empty string to select every output.
+ *
+ * @return 0 if the selection is applied, and non-zero if no model is loaded or a name is unknown.
+ */
+RUNTIME_API int runtime_select_outputs(const char *output_names);
+
+/**
+ * @brief Quantization parameters of an output tensor, real = (q - zero_point) * scale.
+ */
+typedef struct output_quantization_params {
+    tensor_data_type data_type;     // DATA_TYPE_INT8 or DATA_TYPE_UINT8
+    size_t num_channels;            // 1 for per-tensor parameters
+    int axis;                       // Channel axis of per-channel parameters, -1 for per-tensor parameters
+    const float *scales;            // num_channels scales
+    const int32_t *zero_points;     // num_channels zero points
+} output_quantization_params;
+
+/**
+ * @brief This function is called to get the quantization parameters of an output returned in a quantized type.
+ *
+ * @note This function is an extension to the OAAX interface.
+ * @note Outputs are returned quantized when the "output_quantization" initialization argument lists them. They are
+ * quantized on the host with the parameters of that argument, which are the ones returned here: dxrt exposes neither
+ * the NPU's raw integer outputs nor the compiler's quantization parameters.
+ * @note The arrays are owned by the shared library and remain valid until the model is destroyed or another model is
+ * loaded.
+ *
+ * @param output_name The name of the output tensor.
+ * @param params The quantization parameters of the output.
+ *
+ * @return 0 if the output is returned quantized, and non-zero otherwise.
+ */
+RUNTIME_API int runtime_output_quantization(const char *output_name, output_quantization_params *params);
+
+/**
+ * @brief Callback run on the outputs of every inference before receive_output returns them.
+ *
+ * @param output_tensors The outputs, which the callback may modify in place.
+ * @param user_ctx The user context given with the callback.
+ *
+ * @return 0 to return the outputs, non-zero to drop them; receive_output then fails for that inference.
+ */
+typedef int (*output_stage_callback)(tensors_struct *output_tensors, void *user_ctx);
+
+/**
+ * @brief Sets a user stage that processes the outputs of every inference.
+ *
+ * With "pipeline_threads" set, the stage runs on the pipeline workers, overlapping with the inferences and
+ * with the other stages, and outputs still reach receive_output in submission order. Otherwise it runs on
+ * the thread calling receive_output.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param callback The stage, or NULL to remove it.
+ * @param user_ctx The user context passed to the callback.
+ *
+ * @return 0 if the stage is set, and non-zero if a model is already loaded.
+ */
+RUNTIME_API int runtime_set_output_stage(output_stage_callback callback, void *user_ctx);
+
 /**
  * @brief This function is called to retrieve any available output tensors after the inference process is done.
  *
@@ -75,6 +239,70 @@ RUNTIME_API int send_input(tensors_struct *input_tensors);
  */
 RUNTIME_API int receive_output(tensors_struct **output_tensors);
 
+/**
+ * @brief Callback receiving the outputs of every inference, as an alternative to receive_output.
+ *
+ * @param status 0 if the outputs are valid, non-zero if they could not be produced.
+ * @param output_tensors The outputs, owned by the callback from now on, or NULL if status is non-zero.
+ * @param tag The tag given to send_input_tagged, 0 for inputs sent otherwise.
+ * @param user_ctx The user context given with the callback.
+ */
+typedef void (*output_delivery_callback)(int status, tensors_struct *output_tensors, uint64_t tag,
+                                         void *user_ctx);
+
+/**
+ * @brief Delivers the outputs of every inference to a callback instead of queuing them for receive_output.
+ *
+ * The callback is invoked from runtime-owned delivery threads ("output_callback_threads", default 1), or
+ * from the pipeline workers when "pipeline_threads" is set. Callbacks are started in submission order; with
+ * more than one thread they may run concurrently. Slow callbacks apply back-pressure: once
+ * "output_callback_queue_depth" ("pipeline_queue_depth" with the pipeline) outputs wait for a callback, no
+ * further inference completes, and send_input
+ * eventually blocks on the output buffers. receive_output and try_receive_output fail while a callback is set.
+ * Inputs dropped before producing outputs, for instance during runtime_destruction, are reported with a
+ * non-zero status from the thread that dropped them.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param callback The callback, or NULL to return to receive_output.
+ * @param user_ctx The user context passed to the callback.
+ *
+ * @return 0 if the callback is set, and non-zero if a model is already loaded.
+ */
+RUNTIME_API int runtime_set_output_callback(output_delivery_callback callback, void *user_ctx);
+
+/**
+ * @brief Returned by try_receive_output when no output is ready yet.
+ */
+#define RUNTIME_OUTPUT_NOT_READY 2
+
+/**
+ * @brief Retrieves the next output tensors if one is ready, without blocking.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param output_tensors Receives the output tensors, or NULL if none is returned.
+ *
+ * @return 0 if output tensors are returned, RUNTIME_OUTPUT_NOT_READY if no output is ready yet, and another
+ *         non-zero value on failure, including once the runtime is being destroyed.
+ */
+RUNTIME_API int try_receive_output(tensors_struct **output_tensors);
+
+/**
+ * @brief Returns a file descriptor that is readable while outputs are ready to be received.
+ *
+ * The descriptor is level-triggered: it stays readable until the last ready output has been taken with
+ * receive_output or try_receive_output, and it also becomes readable when the runtime is being destroyed.
+ * It is meant to be added to an epoll, poll or select loop that then calls try_receive_output until it
+ * returns RUNTIME_OUTPUT_NOT_READY. The caller must not read from or close it; it is closed by
+ * runtime_destruction. It is an eventfd on Linux and the read end of a pipe on other POSIX systems.
+ *
+ * @note This function is an extension to the OAAX interface, and is not supported on Windows.
+ *
+ * @return The file descriptor, or -1 if it cannot be created.
+ */
+RUNTIME_API int runtime_output_fd();
+
 /**
  * @brief This function is called to destroy the runtime environment after the inference process is stopped.
 
@@ -89,6 +317,15 @@ RUNTIME_API int runtime_destruction();
  */
 RUNTIME_API const char *runtime_error_message();
 
+/**
+ * @brief This function is called to get the runtime statistics.
+ *
+ * @note This function is an extension to the OAAX interface.
+
+ * @return The statistics as a JSON object. The string is owned by the shared library and remains valid until the next call.
+ */
+RUNTIME_API const char *runtime_stats();
+
 /**
  * @brief This function is called to get the version of the shared library.
 
@@ -103,6 +340,257 @@ RUNTIME_API const char *runtime_version();
  */
 RUNTIME_API const char *runtime_name();
 
+/**
+ * @brief An independent runtime with its own model, buffer pools, queues and threads.
+ *
+ * The OAAX functions above operate on a default context. Further contexts let one process serve several
+ * models concurrently while sharing the dxrt runtime. Each runtime_context_* function behaves like the OAAX
+ * function of the same name, applied to the given context. Logging, thread and NUMA placement, the fd input
+ * cache and the tensors allocator are process-wide: they are set by whichever context's arguments name them
+ * last and reset by runtime_destruction, which should therefore be called after the other contexts are
+ * destroyed.
+ */
+typedef struct runtime_context runtime_context;
+
+/**
+ * @brief Creates a context configured with the same arguments as runtime_initialization_with_args.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return The context, or NULL if an argument is invalid or the allocation failed.
+ */
+RUNTIME_API runtime_context *runtime_context_create(int length, const char **keys, const void **values);
+
+/**
+ * @brief Destroys a context created with runtime_context_create, draining it as runtime_destruction does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the context is destroyed, and non-zero if it is NULL.
+ */
+RUNTIME_API int runtime_context_destruction(runtime_context *context);
+
+/**
+ * @brief Loads a model into the context, as runtime_model_loading does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the model is loaded, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_model_loading(runtime_context *context, const char *file_path);
+
+/**
+ * @brief Sends an input to the context, as send_input does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the input is stored, and non-zero otherwise or if the context is NULL, in which case the caller keeps
+ *         the input.
+ */
+RUNTIME_API int runtime_context_send_input(runtime_context *context, tensors_struct *input_tensors);
+
+/**
+ * @brief Sends an input with a correlation tag to the context, as send_input_tagged does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the input is stored, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_send_input_tagged(runtime_context *context, tensors_struct *input_tensors, uint64_t tag);
+
+/**
+ * @brief Sends an input with a priority class and a deadline to the context, as send_input_scheduled does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the input is stored, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_send_input_scheduled(runtime_context *context, tensors_struct *input_tensors,
+                                                     uint64_t tag, int priority, uint64_t deadline_us);
+
+/**
+ * @brief Submits a file-descriptor-backed input to the context, as send_input_fd does.
+ *
+ * @note This function is an extension to the OAAX interface, and is only supported on Linux.
+ *
+ * @return 0 if the input is submitted, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_send_input_fd(runtime_context *context, int fd, size_t offset, size_t size,
+                                              input_release_callback release, void *user_ctx);
+
+/**
+ * @brief Runs one inference synchronously on the context's model, as runtime_infer does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the inference succeeded, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_infer(runtime_context *context, const tensors_struct *input_tensors,
+                                      tensors_struct **output_tensors);
+
+/**
+ * @brief Retrieves the next output tensors of the context, as receive_output does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if outputs are returned, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_receive_output(runtime_context *context, tensors_struct **output_tensors);
+
+/**
+ * @brief Retrieves the next output tensors of the context without blocking, as try_receive_output does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return As try_receive_output, or 1 if the context is NULL.
+ */
+RUNTIME_API int runtime_context_try_receive_output(runtime_context *context, tensors_struct **output_tensors);
+
+/**
+ * @brief Returns the output-ready file descriptor of the context, as runtime_output_fd does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return The file descriptor, or -1 if it cannot be created or the context is NULL.
+ */
+RUNTIME_API int runtime_context_output_fd(runtime_context *context);
+
+/**
+ * @brief Gets the quantization parameters of an output of the context's model, as runtime_output_quantization does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the output is returned quantized, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_output_quantization(runtime_context *context, const char *output_name,
+                                                    output_quantization_params *params);
+
+/**
+ * @brief Selects the output tensors returned by the context, as runtime_select_outputs does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the selection is applied, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_select_outputs(runtime_context *context, const char *output_names);
+
+/**
+ * @brief Registers the callback receiving the outputs of the context, as runtime_set_output_callback does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the callback is registered, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_set_output_callback(runtime_context *context, output_delivery_callback callback,
+                                                    void *user_ctx);
+
+/**
+ * @brief Registers a stage running on the context's output pipeline, as runtime_set_output_stage does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the stage is registered, and non-zero otherwise or if the context is NULL.
+ */
+RUNTIME_API int runtime_context_set_output_stage(runtime_context *context, output_stage_callback callback,
+                                                 void *user_ctx);
+
+/**
+ * @brief Returns the statistics of the context, as runtime_stats does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return The statistics as JSON, valid until the next call for the context, or NULL if the context is NULL.
+ */
+RUNTIME_API const char *runtime_context_stats(runtime_context *context);
+
+/**
+ * @brief A source of inputs, such as one camera, sharing a context fairly with the other streams.
+ *
+ * The inputs of each stream wait in their own queue and are admitted to the device in deficit round-robin
+ * order: every stream with pending inputs gets up to weight inferences per round, and at most max_in_flight
+ * of its inferences are on the device or waiting to be received at once. Priority classes and deadlines,
+ * given with runtime_stream_send_input_scheduled, take precedence over the round-robin order. The outputs of
+ * each stream are received in its admission order from its own queue. Inputs sent with send_input bypass
+ * the streams.
+ * Streams cannot be used with an output callback, and are destroyed with their context.
+ */
+typedef struct runtime_stream runtime_stream;
+
+/**
+ * @brief Creates a stream on the default context, once the model is loaded.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param max_in_flight Inferences of the stream admitted and not yet received, at least 1. send_input on the
+ *                      stream also blocks once this many inputs are waiting to be admitted.
+ * @param weight Inferences admitted per round while other streams are waiting, at least 1.
+ *
+ * @return The stream, or NULL if no model is loaded or an output callback is registered.
+ */
+RUNTIME_API runtime_stream *runtime_stream_create(int max_in_flight, int weight);
+
+/**
+ * @brief Creates a stream on the given context, as runtime_stream_create does on the default context.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return The stream, or NULL if the context is NULL, no model is loaded or an output callback is registered.
+ */
+RUNTIME_API runtime_stream *runtime_context_stream_create(runtime_context *context, int max_in_flight, int weight);
+
+/**
+ * @brief Queues an input on the stream, as send_input does. Ownership of the input passes to the runtime on
+ *        success only.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the input is queued, and non-zero if it is invalid or the stream is NULL or being destroyed.
+ */
+RUNTIME_API int runtime_stream_send_input(runtime_stream *stream, tensors_struct *input_tensors);
+
+/**
+ * @brief Queues an input on the stream with a priority class and a deadline, as send_input_scheduled does.
+ *
+ * Across streams, the highest priority class among the inputs at the head of the streams' queues is served
+ * first, then the earliest deadline in that class, then the streams in round-robin order. Within a stream,
+ * inputs are ordered the same way, so its outputs follow the submission order as long as its priority does
+ * not increase and its deadlines do not go backwards. The stream quota applies whatever the priority.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @param priority The priority class; runtime_stream_send_input uses class 0.
+ * @param deadline_us The absolute deadline on runtime_clock_us(), or 0 for none.
+ */
+RUNTIME_API int runtime_stream_send_input_scheduled(runtime_stream *stream, tensors_struct *input_tensors, int priority,
+                                                    uint64_t deadline_us);
+
+/**
+ * @brief Retrieves the next output tensors of the stream, as receive_output does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ */
+RUNTIME_API int runtime_stream_receive_output(runtime_stream *stream, tensors_struct **output_tensors);
+
+/**
+ * @brief Retrieves the next output tensors of the stream without blocking, as try_receive_output does.
+ *
+ * @note This function is an extension to the OAAX interface.
+ */
+RUNTIME_API int runtime_stream_try_receive_output(runtime_stream *stream, tensors_struct **output_tensors);
+
+/**
+ * @brief Destroys a stream. Inputs not admitted yet are freed, and the outputs of the others are waited for
+ *        and freed.
+ *
+ * Threads blocked in runtime_stream_receive_output on the stream return non-zero once its queue is empty, and
+ * the stream is only freed after they have left. No call on the stream may start once this one returns.
+ *
+ * @note This function is an extension to the OAAX interface.
+ *
+ * @return 0 if the stream is destroyed, and non-zero if it is NULL.
+ */
+RUNTIME_API int runtime_stream_destruction(runtime_stream *stream);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,284 @@
+#ifndef RUNTIME_TENSORS_HPP
+#define RUNTIME_TENSORS_HPP
+
+#include "runtime_core.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Header-only C++ ownership types over tensors_struct.
+ *
+ * Tensors owns a tensors_struct and is move-only, so copies only happen through clone(). TensorsView and
+ * TensorView borrow one without owning it, and typed spans give checked access to the data. Ownership
+ * moves into the runtime explicitly with oaax::send_input(std::move(inputs)); if the runtime rejects the
+ * inputs they stay with the caller, so the C convention of "the runtime frees the inputs on success, the
+ * caller on failure" is kept by the types rather than by hand.
+ */
+namespace oaax {
+
+/**
+ * The tensor_data_type of a C++ element type.
+ */
+template <typename T> struct DataType;
+template <> struct DataType<float> : std::integral_constant<tensor_data_type, DATA_TYPE_FLOAT> {};
+template <> struct DataType<double> : std::integral_constant<tensor_data_type, DATA_TYPE_DOUBLE> {};
+template <> struct DataType<uint8_t> : std::integral_constant<tensor_data_type, DATA_TYPE_UINT8> {};
+template <> struct DataType<int8_t> : std::integral_constant<tensor_data_type, DATA_TYPE_INT8> {};
+template <> struct DataType<uint16_t> : std::integral_constant<tensor_data_type, DATA_TYPE_UINT16> {};
+template <> struct DataType<int16_t> : std::integral_constant<tensor_data_type, DATA_TYPE_INT16> {};
+template <> struct DataType<uint32_t> : std::integral_constant<tensor_data_type, DATA_TYPE_UINT32> {};
+template <> struct DataType<int32_t> : std::integral_constant<tensor_data_type, DATA_TYPE_INT32> {};
+template <> struct DataType<uint64_t> : std::integral_constant<tensor_data_type, DATA_TYPE_UINT64> {};
+template <> struct DataType<int64_t> : std::integral_constant<tensor_data_type, DATA_TYPE_INT64> {};
+template <> struct DataType<bool> : std::integral_constant<tensor_data_type, DATA_TYPE_BOOL> {};
+
+/**
+ * Contiguous elements borrowed from a tensor.
+ */
+template <typename T> class Span {
+public:
+    Span() = default;
+    Span(T *data, size_t size) : data_(data), size_(size) {}
+
+    T *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T *begin() const { return data_; }
+    T *end() const { return data_ + size_; }
+    T &operator[](size_t i) const { return data_[i]; }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * One tensor of a tensors_struct, borrowed.
+ */
+class TensorView {
+public:
+    TensorView(tensors_struct *tensors, size_t index) : tensors_(tensors), index_(index) {}
+
+    const char *name() const { return tensors_->names[index_]; }
+    tensor_data_type type() const { return tensors_->data_types[index_]; }
+    Span<const size_t> shape() const { return Span<const size_t>(tensors_->shapes[index_], tensors_->ranks[index_]); }
+    void *data() const { return tensors_->data[index_]; }
+
+    size_t elements() const {
+        size_t count = 1;
+        for (size_t dim : shape()) {
+            count *= dim;
+        }
+        return count;
+    }
+
+    size_t bytes() const { return elements() * static_cast<size_t>(get_data_type_byte_size(type())); }
+
+    /**
+     * @throws std::invalid_argument if T does not match the tensor's data type.
+     */
+    template <typename T> Span<T> as() const {
+        if (DataType<typename std::remove_const<T>::type>::value != type()) {
+            throw std::invalid_argument(std::string("Tensor ") + name() + " has a different data type");
+        }
+        return Span<T>(static_cast<T *>(data()), elements());
+    }
+
+private:
+    tensors_struct *tensors_;
+    size_t index_;
+};
+
+/**
+ * A tensors_struct, borrowed. It must outlive the view.
+ */
+class TensorsView {
+public:
+    TensorsView() = default;
+    TensorsView(tensors_struct *tensors) : tensors_(tensors) {}
+
+    tensors_struct *get() const { return tensors_; }
+    size_t size() const { return tensors_ != nullptr ? tensors_->num_tensors : 0; }
+    TensorView operator[](size_t index) const { return TensorView(tensors_, index); }
+
+    /**
+     * @throws std::out_of_range if no tensor has the name.
+     */
+    TensorView at(const char *name) const {
+        for (size_t i = 0; i < size(); i++) {
+            if (tensors_->names[i] != nullptr && strcmp(tensors_->names[i], name) == 0) {
+                return TensorView(tensors_, i);
+            }
+        }
+        throw std::out_of_range(std::string("No tensor named ") + name);
+    }
+
+private:
+    tensors_struct *tensors_ = nullptr;
+};
+
+struct TensorSpec {
+    std::string name;
+    tensor_data_type type;
+    std::vector<size_t> shape;
+};
+
+/**
+ * Owns a tensors_struct, freed with deep_free_tensors_struct and so through the tensors allocator.
+ */
+class Tensors {
+public:
+    Tensors() = default;
+    explicit Tensors(tensors_struct *tensors) : tensors_(tensors) {}
+    ~Tensors() { reset(); }
+
+    Tensors(Tensors &&other) noexcept : tensors_(other.release()) {}
+    Tensors &operator=(Tensors &&other) noexcept {
+        reset(other.release());
+        return *this;
+    }
+    Tensors(const Tensors &) = delete;
+    Tensors &operator=(const Tensors &) = delete;
+
+    /**
+     * Allocates tensors of the given names, types and shapes through the tensors allocator.
+     *
+     * @param alignment Alignment of every data buffer, a power of two multiple of sizeof(void*).
+     * @throws std::bad_alloc if an allocation fails.
+     */
+    static Tensors allocate(const std::vector<TensorSpec> &specs, size_t alignment = 64) {
+        tensors_struct *raw = allocate_tensors_struct(static_cast<int>(specs.size()));
+        if (raw == nullptr) {
+            throw std::bad_alloc();
+        }
+        for (size_t i = 0; i < specs.size(); i++) {
+            raw->names[i] = nullptr;
+            raw->shapes[i] = nullptr;
+            raw->data[i] = nullptr;
+            raw->data_types[i] = specs[i].type;
+            raw->ranks[i] = specs[i].shape.size();
+        }
+        Tensors tensors(raw);
+        for (size_t i = 0; i < specs.size(); i++) {
+            const std::vector<size_t> &shape = specs[i].shape;
+            size_t bytes = static_cast<size_t>(get_data_type_byte_size(specs[i].type));
+            for (size_t dim : shape) {
+                bytes *= dim;
+            }
+            raw->names[i] = tensors_strdup(specs[i].name.c_str());
+            raw->shapes[i] = static_cast<size_t *>(tensors_malloc((shape.empty() ? 1 : shape.size()) * sizeof(size_t)));
+            raw->data[i] = tensors_aligned_malloc(alignment, bytes > 0 ? bytes : 1);
+            if (raw->names[i] == nullptr || raw->shapes[i] == nullptr || raw->data[i] == nullptr) {
+                throw std::bad_alloc();
+            }
+            std::copy(shape.begin(), shape.end(), raw->shapes[i]);
+        }
+        return tensors;
+    }
+
+    /**
+     * @return A deep copy, the only way to copy tensors.
+     * @throws std::bad_alloc if the copy fails.
+     */
+    Tensors clone() const {
+        if (tensors_ == nullptr) {
+            return Tensors();
+        }
+        tensors_struct *copy = deep_copy_tensors_struct(tensors_);
+        if (copy == nullptr) {
+            throw std::bad_alloc();
+        }
+        return Tensors(copy);
+    }
+
+    tensors_struct *get() const { return tensors_; }
+    explicit operator bool() const { return tensors_ != nullptr; }
+
+    /**
+     * Gives up ownership without freeing anything.
+     */
+    tensors_struct *release() {
+        tensors_struct *tensors = tensors_;
+        tensors_ = nullptr;
+        return tensors;
+    }
+
+    void reset(tensors_struct *tensors = nullptr) {
+        tensors_struct *previous = tensors_;
+        tensors_ = tensors;
+        if (previous != nullptr) {
+            deep_free_tensors_struct(previous);
+        }
+    }
+
+    TensorsView view() const { return TensorsView(tensors_); }
+    operator TensorsView() const { return view(); }
+    size_t size() const { return view().size(); }
+    TensorView operator[](size_t index) const { return view()[index]; }
+    TensorView at(const char *name) const { return view().at(name); }
+
+private:
+    tensors_struct *tensors_ = nullptr;
+};
+
+/**
+ * Moves the inputs into the runtime. They are left with the caller, untouched, if the runtime rejects them.
+ */
+inline int send_input(Tensors &&inputs) {
+    int status = ::send_input(inputs.get());
+    if (status == 0) {
+        inputs.release();
+    }
+    return status;
+}
+
+/**
+ * As send_input, with a tag handed back to the output callback.
+ */
+inline int send_input_tagged(Tensors &&inputs, uint64_t tag) {
+    int status = ::send_input_tagged(inputs.get(), tag);
+    if (status == 0) {
+        inputs.release();
+    }
+    return status;
+}
+
+inline int receive_output(Tensors &outputs) {
+    tensors_struct *raw = nullptr;
+    int status = ::receive_output(&raw);
+    outputs.reset(raw);
+    return status;
+}
+
+inline int try_receive_output(Tensors &outputs) {
+    tensors_struct *raw = nullptr;
+    int status = ::try_receive_output(&raw);
+    outputs.reset(raw);
+    return status;
+}
+
+/**
+ * Runs one inference synchronously. If outputs already holds tensors, the outputs are written into them in
+ * place, so the same Tensors can be reused from call to call; otherwise it receives new tensors.
+ */
+inline int runtime_infer(TensorsView inputs, Tensors &outputs) {
+    tensors_struct *raw = outputs.get();
+    int status = ::runtime_infer(inputs.get(), &raw);
+    if (raw != outputs.get()) {
+        outputs.reset(raw);
+    }
+    return status;
+}
+
+} // namespace oaax
+
+#endif // RUNTIME_TENSORS_HPP
@@ -0,0 +1,99 @@
+#include "classification_postprocess.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLASSIFICATION_SSE2 1
+#endif
+
+namespace {
+
+struct Ranked {
+    float score;
+    size_t index;
+};
+
+// The K best entries sorted by decreasing score. K is small, so an insertion into a sorted array beats a heap.
+class TopK {
+public:
+    explicit TopK(size_t k) : k_(k) { entries_.reserve(k + 1); }
+
+    float worst() const { return entries_.size() < k_ ? -INFINITY : entries_.back().score; }
+
+    void offer(float score, size_t index) {
+        if (!(score > worst())) return;
+        auto it = std::upper_bound(entries_.begin(), entries_.end(), score,
+                                   [](float s, const Ranked &r) { return s > r.score; });
+        entries_.insert(it, Ranked{score, index});
+        if (entries_.size() > k_) entries_.pop_back();
+    }
+
+    const std::vector<Ranked> &entries() const { return entries_; }
+
+private:
+    size_t k_;
+    std::vector<Ranked> entries_;
+};
+
+} // namespace
+
+ClassificationPostprocessor::ClassificationPostprocessor(const PostprocessOptions &options) : options_(options) {}
+
+bool ClassificationPostprocessor::init(const std::vector<PostprocessTensor> &outputs) {
+    output_ = postprocess_find_output(outputs, options_);
+    if (output_ < 0) {
+        spdlog::error("[classification] Output '{}' not found", options_.output);
+        return false;
+    }
+    const PostprocessTensor &tensor = outputs[output_];
+    classes_ = 1;
+    for (int64_t dim : tensor.shape) {
+        classes_ *= dim > 0 ? static_cast<size_t>(dim) : 0;
+    }
+    if (tensor.type != DATA_TYPE_FLOAT || tensor.shape.empty() || classes_ == 0) {
+        spdlog::error("[classification] Output {} must be a non-empty float tensor", tensor.name);
+        return false;
+    }
+    top_k_ = std::min(options_.top_k, classes_);
+    spdlog::info("[classification] Top {} of {} classes{}", top_k_, classes_, options_.softmax ? ", softmax" : "");
+    return true;
+}
+
+tensors_struct *ClassificationPostprocessor::run(const std::vector<PostprocessTensor> &outputs) {
+    const float *logits = static_cast<const float *>(outputs[output_].data);
+
+    TopK top(top_k_);
+    size_t i = 0;
+#if defined(CLASSIFICATION_SSE2)
+    for (; i + 4 <= classes_; i += 4) {
+        __m128 values = _mm_loadu_ps(logits + i);
+        if (_mm_movemask_ps(_mm_cmpgt_ps(values, _mm_set1_ps(top.worst()))) == 0) continue;
+        for (size_t j = i; j < i + 4; j++) {
+            top.offer(logits[j], j);
+        }
+    }
+#endif
+    for (; i < classes_; i++) {
+        top.offer(logits[i], i);
+    }
+
+    const std::vector<Ranked> &entries = top.entries();
+    float max = entries.empty() ? 0.0f : entries[0].score;
+    float inverse_sum = options_.softmax ? 1.0f / postprocess_exp_sum(logits, classes_, max) : 0.0f;
+
+    tensors_struct *result = postprocess_allocate_result("classes", DATA_TYPE_FLOAT, {entries.size(), 2});
+    if (result == nullptr) {
+        return nullptr;
+    }
+    float *classes = static_cast<float *>(result->data[0]);
+    for (size_t k = 0; k < entries.size(); k++) {
+        classes[k * 2] = static_cast<float>(entries[k].index);
+        classes[k * 2 + 1] = options_.softmax ? expf(entries[k].score - max) * inverse_sum : entries[k].score;
+    }
+    return result;
+}
@@ -0,0 +1,28 @@
+#ifndef CLASSIFICATION_POSTPROCESS_H
+#define CLASSIFICATION_POSTPROCESS_H
+
+#include "postprocess.h"
+
+/**
+ * @brief Reduces a logits output to its top-K classes.
+ *
+ * The K best logits are selected in one pass that skips four logits at a time when none beats the current
+ * K-th best. Softmax is monotonic, so only the normalization sum is computed over the whole output, and
+ * only for the selected classes when probabilities are requested. The result is a single "classes" float
+ * tensor of shape [K, 2] holding the class index and its score, by decreasing score.
+ */
+class ClassificationPostprocessor : public Postprocessor {
+public:
+    explicit ClassificationPostprocessor(const PostprocessOptions &options);
+
+    bool init(const std::vector<PostprocessTensor> &outputs) override;
+    tensors_struct *run(const std::vector<PostprocessTensor> &outputs) override;
+
+private:
+    PostprocessOptions options_;
+    int output_ = -1;
+    size_t classes_ = 0;
+    size_t top_k_ = 0;
+};
+
+#endif // CLASSIFICATION_POSTPROCESS_H
@@ -0,0 +1,147 @@
+#include "copy_engine.h"
+#include "stream_copy.h"
+#include "thread_placement.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+
+#include <spdlog/spdlog.h>
+
+static const size_t CHUNK_ALIGNMENT = 64;
+
+CopyEngine::~CopyEngine() {
+    stop();
+}
+
+void CopyEngine::start(const CopyEngineOptions &options) {
+    stop();
+    options_ = options;
+    options_.min_chunk = std::max(options_.min_chunk, CHUNK_ALIGNMENT);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+    }
+    for (size_t i = 0; i < options_.threads; i++) {
+        workers_.push_back(std::thread(&CopyEngine::worker_loop, this));
+    }
+    if (!workers_.empty()) {
+        spdlog::info("Copy engine started with {} workers (parallel >= {} bytes, streaming >= {} bytes)",
+                     workers_.size(), options_.parallel_threshold, options_.stream_threshold);
+    }
+}
+
+void CopyEngine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    chunks_cv_.notify_all();
+    for (auto &worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+}
+
+void CopyEngine::copy_chunk(const CopyTask &task) {
+    if (options_.stream_threshold > 0 && task.size >= options_.stream_threshold) {
+        stream_copy(task.dst, task.src, task.size);
+        streamed_bytes_ += task.size;
+    } else {
+        memcpy(task.dst, task.src, task.size);
+    }
+    copied_bytes_ += task.size;
+}
+
+void CopyEngine::finish_chunk(Batch *batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--batch->remaining == 0) batch->done.notify_all();
+}
+
+void CopyEngine::worker_loop() {
+    thread_placement_apply("copy");
+
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            chunks_cv_.wait(lock, [this]() { return stop_ || !chunks_.empty(); });
+            if (chunks_.empty()) break;
+            chunk = chunks_.front();
+            chunks_.pop_front();
+        }
+        copy_chunk(chunk.task);
+        finish_chunk(chunk.batch);
+    }
+}
+
+void CopyEngine::copy(const std::vector<CopyTask> &tasks) {
+    size_t parallel = workers_.size() + 1;
+    Batch batch;
+    std::vector<Chunk> chunks;
+    for (const auto &task : tasks) {
+        if (workers_.empty() || task.size < options_.parallel_threshold) {
+            copy_chunk(task);
+            continue;
+        }
+
+        // One chunk per participating thread, cache-line aligned and no smaller than min_chunk.
+        size_t chunk_size = std::max((task.size + parallel - 1) / parallel, options_.min_chunk);
+        chunk_size = (chunk_size + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+        for (size_t offset = 0; offset < task.size; offset += chunk_size) {
+            CopyTask part;
+            part.dst = static_cast<uint8_t *>(task.dst) + offset;
+            part.src = static_cast<const uint8_t *>(task.src) + offset;
+            part.size = std::min(chunk_size, task.size - offset);
+            chunks.push_back(Chunk{part, &batch});
+        }
+        parallel_copies_++;
+    }
+    if (chunks.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.remaining = chunks.size();
+        chunks_.insert(chunks_.end(), chunks.begin(), chunks.end());
+    }
+    chunks_cv_.notify_all();
+
+    // The calling thread works on the queue too instead of sleeping until the workers are done.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (batch.remaining > 0) {
+        if (chunks_.empty()) {
+            batch.done.wait(lock);
+            continue;
+        }
+        Chunk chunk = chunks_.front();
+        chunks_.pop_front();
+        lock.unlock();
+        copy_chunk(chunk.task);
+        finish_chunk(chunk.batch);
+        lock.lock();
+    }
+}
+
+std::string CopyEngine::stats_json() const {
+    std::ostringstream out;
+    out << "{\"threads\":" << workers_.size() << ",\"copied_bytes\":" << copied_bytes_.load()
+        << ",\"streamed_bytes\":" << streamed_bytes_.load() << ",\"parallel_copies\":" << parallel_copies_.load() << "}";
+    return out.str();
+}
+
+bool copy_engine_parse_arg(const char *key, const void *value, CopyEngineOptions &options) {
+    if (strcmp(key, "copy_threads") == 0) {
+        options.threads = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0));
+        return true;
+    }
+    if (strcmp(key, "copy_parallel_threshold_kb") == 0) {
+        options.parallel_threshold = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0)) * 1024;
+        return true;
+    }
+    if (strcmp(key, "copy_stream_threshold_kb") == 0) {
+        options.stream_threshold = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0)) * 1024;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,98 @@
+#ifndef COPY_ENGINE_H
+#define COPY_ENGINE_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CopyEngineOptions {
+    size_t threads = 0;                         // Worker threads, 0 copies on the calling thread only
+    size_t parallel_threshold = 1024 * 1024;    // Copies at least this large are split across the workers
+    size_t stream_threshold = 0;                // Chunks at least this large use non-temporal stores, 0 for none
+    size_t min_chunk = 256 * 1024;              // Smallest chunk handed to a worker
+};
+
+struct CopyTask {
+    void *dst;
+    const void *src;
+    size_t size;
+};
+
+/**
+ * @brief Copies large buffers in parallel on a small worker pool.
+ *
+ * Tasks of at least parallel_threshold bytes are split into chunks that the workers and the calling
+ * thread copy together; smaller tasks are copied on the calling thread. Chunks are copied with memcpy,
+ * or with non-temporal stores from stream_threshold bytes on if it is set. Streaming keeps large outputs
+ * out of the copying core's cache, which only pays off when the consumer does not read them right away,
+ * so it is opt-in.
+ */
+class CopyEngine {
+public:
+    CopyEngine() = default;
+    ~CopyEngine();
+
+    CopyEngine(const CopyEngine &) = delete;
+    CopyEngine &operator=(const CopyEngine &) = delete;
+
+    /**
+     * @brief Starts the worker threads, named after the "copy" thread placement role.
+     */
+    void start(const CopyEngineOptions &options);
+
+    /**
+     * @brief Stops and joins the worker threads.
+     */
+    void stop();
+
+    /**
+     * @brief Copies all tasks and returns once every byte is copied.
+     */
+    void copy(const std::vector<CopyTask> &tasks);
+
+    /**
+     * @return The copy statistics as a JSON object.
+     */
+    std::string stats_json() const;
+
+private:
+    struct Batch {
+        size_t remaining = 0;
+        std::condition_variable done;
+    };
+
+    struct Chunk {
+        CopyTask task;
+        Batch *batch;
+    };
+
+    void worker_loop();
+    void copy_chunk(const CopyTask &task);
+    void finish_chunk(Batch *batch);
+
+    CopyEngineOptions options_;
+    std::vector<std::thread> workers_;
+    std::deque<Chunk> chunks_;
+    std::mutex mutex_;
+    std::condition_variable chunks_cv_;
+    bool stop_ = false;
+
+    std::atomic<unsigned long long> copied_bytes_{0};
+    std::atomic<unsigned long long> streamed_bytes_{0};
+    std::atomic<unsigned long long> parallel_copies_{0};
+};
+
+/**
+ * @brief Consumes an initialization argument if it is a copy engine key.
+ *
+ * @return true if the key was consumed, false otherwise.
+ */
+bool copy_engine_parse_arg(const char *key, const void *value, CopyEngineOptions &options);
+
+#endif // COPY_ENGINE_H
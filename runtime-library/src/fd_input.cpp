@@ -0,0 +1,184 @@
+#include "fd_input.h"
+
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+static const size_t DEFAULT_CACHE_SIZE = 64;
+
+struct FdInputEntry {
+    unsigned long long dev = 0;
+    unsigned long long ino = 0;
+    int fd = -1;                // Duplicate owned by the cache
+    void *base = nullptr;
+    size_t length = 0;
+    size_t refs = 0;
+    bool dmabuf = false;
+    bool retired = false;       // Replaced by a larger mapping, destroyed once unreferenced
+    unsigned long long last_used = 0;
+};
+
+typedef std::pair<unsigned long long, unsigned long long> FileKey;
+
+static std::mutex fd_input_mutex;
+static std::map<FileKey, FdInputEntry *> fd_input_cache;
+static size_t fd_input_cache_size = DEFAULT_CACHE_SIZE;
+static size_t fd_input_idle = 0;
+static unsigned long long fd_input_clock = 0;
+
+#if defined(__linux__)
+static void destroy_entry(FdInputEntry *entry) {
+    if (entry->base) munmap(entry->base, entry->length);
+    if (entry->fd >= 0) close(entry->fd);
+    delete entry;
+}
+
+static bool dmabuf_sync(int fd, unsigned long long flags) {
+    struct dma_buf_sync sync;
+    sync.flags = flags | DMA_BUF_SYNC_READ;
+    while (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) != 0) {
+        if (errno != EINTR && errno != EAGAIN) return false;
+    }
+    return true;
+}
+
+// Destroys least recently used idle entries beyond the cache size.
+static void evict_idle_entries() {
+    while (fd_input_idle > fd_input_cache_size) {
+        auto victim = fd_input_cache.end();
+        for (auto it = fd_input_cache.begin(); it != fd_input_cache.end(); ++it) {
+            if (it->second->refs != 0) continue;
+            if (victim == fd_input_cache.end() || it->second->last_used < victim->second->last_used) victim = it;
+        }
+        if (victim == fd_input_cache.end()) return;
+        destroy_entry(victim->second);
+        fd_input_cache.erase(victim);
+        fd_input_idle--;
+    }
+}
+#endif
+
+bool fd_input_acquire(int fd, size_t offset, size_t size, FdInputMapping &mapping) {
+#if defined(__linux__)
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        spdlog::error("[fd_input] fstat failed for fd {}: {}", fd, strerror(errno));
+        return false;
+    }
+    if (S_ISREG(st.st_mode) && static_cast<unsigned long long>(st.st_size) < offset + size) {
+        spdlog::error("[fd_input] Range [{}, {}) exceeds the {} bytes of fd {}", offset, offset + size, st.st_size, fd);
+        return false;
+    }
+
+    FileKey key(static_cast<unsigned long long>(st.st_dev), static_cast<unsigned long long>(st.st_ino));
+    std::lock_guard<std::mutex> lock(fd_input_mutex);
+
+    FdInputEntry *entry = nullptr;
+    auto it = fd_input_cache.find(key);
+    if (it != fd_input_cache.end()) {
+        entry = it->second;
+        if (entry->length < offset + size) {
+            // Keep in-flight users of the smaller mapping valid and map the file again.
+            if (entry->refs == 0) {
+                destroy_entry(entry);
+                fd_input_idle--;
+            } else {
+                entry->retired = true;
+            }
+            fd_input_cache.erase(it);
+            entry = nullptr;
+        }
+    }
+
+    bool created = false;
+    if (!entry) {
+        void *base = mmap(nullptr, offset + size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            spdlog::error("[fd_input] Failed to map {} bytes of fd {}: {}", offset + size, fd, strerror(errno));
+            return false;
+        }
+        entry = new FdInputEntry();
+        entry->dev = key.first;
+        entry->ino = key.second;
+        entry->base = base;
+        entry->length = offset + size;
+        entry->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        // Only dma-bufs accept DMA_BUF_IOCTL_SYNC; it starts the first access at the same time.
+        entry->dmabuf = entry->fd >= 0 && dmabuf_sync(entry->fd, DMA_BUF_SYNC_START);
+        fd_input_cache[key] = entry;
+        fd_input_idle++;
+        created = true;
+    }
+
+    if (entry->refs == 0) fd_input_idle--;
+    entry->refs++;
+    entry->last_used = ++fd_input_clock;
+    if (entry->dmabuf && !created) dmabuf_sync(entry->fd, DMA_BUF_SYNC_START);
+
+    mapping.data = static_cast<char *>(entry->base) + offset;
+    mapping.entry = entry;
+    return true;
+#else
+    (void)fd;
+    (void)offset;
+    (void)size;
+    (void)mapping;
+    spdlog::error("[fd_input] File-descriptor inputs are not supported on this platform");
+    return false;
+#endif
+}
+
+void fd_input_release(FdInputMapping &mapping) {
+#if defined(__linux__)
+    FdInputEntry *entry = mapping.entry;
+    if (!entry) return;
+    std::lock_guard<std::mutex> lock(fd_input_mutex);
+    if (entry->dmabuf) dmabuf_sync(entry->fd, DMA_BUF_SYNC_END);
+    if (--entry->refs == 0) {
+        if (entry->retired) {
+            destroy_entry(entry);
+        } else {
+            fd_input_idle++;
+            evict_idle_entries();
+        }
+    }
+#endif
+    mapping = FdInputMapping();
+}
+
+void fd_input_set_cache_size(size_t entries) {
+    std::lock_guard<std::mutex> lock(fd_input_mutex);
+    fd_input_cache_size = entries;
+#if defined(__linux__)
+    evict_idle_entries();
+#endif
+}
+
+void fd_input_reset() {
+    std::lock_guard<std::mutex> lock(fd_input_mutex);
+    fd_input_cache_size = DEFAULT_CACHE_SIZE;
+#if defined(__linux__)
+    for (auto it = fd_input_cache.begin(); it != fd_input_cache.end();) {
+        if (it->second->refs == 0) {
+            destroy_entry(it->second);
+            it = fd_input_cache.erase(it);
+            fd_input_idle--;
+        } else {
+            ++it;
+        }
+    }
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef FD_INPUT_H
+#define FD_INPUT_H
+
+#include <stddef.h>
+
+struct FdInputEntry;
+
+/**
+ * @brief A read-only view into a mapped file-descriptor-backed input buffer.
+ */
+struct FdInputMapping {
+    void *data = nullptr;           // Mapped address of the requested offset
+    FdInputEntry *entry = nullptr;  // Cache entry kept alive until fd_input_release()
+};
+
+/**
+ * @brief Maps [offset, offset + size) of a memfd, dma-buf or other mappable fd.
+ *
+ * Mappings are cached by file identity (device and inode), so a buffer that is submitted again,
+ * even through a different fd number, is only mapped once. The cache keeps its own duplicate of
+ * the fd, so the caller may close theirs as soon as this function returns. For dma-bufs, CPU access
+ * is bracketed with DMA_BUF_IOCTL_SYNC until fd_input_release().
+ *
+ * @return true on success, false otherwise.
+ */
+bool fd_input_acquire(int fd, size_t offset, size_t size, FdInputMapping &mapping);
+
+/**
+ * @brief Ends the access started by fd_input_acquire().
+ */
+void fd_input_release(FdInputMapping &mapping);
+
+/**
+ * @brief Sets the number of unused mappings kept in the cache.
+ */
+void fd_input_set_cache_size(size_t entries);
+
+/**
+ * @brief Unmaps every unused mapping and restores the default cache size.
+ */
+void fd_input_reset();
+
+#endif // FD_INPUT_H
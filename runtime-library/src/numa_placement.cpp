@@ -0,0 +1,234 @@
+#include "numa_placement.h"
+#include "string_list.h"
+#include "thread_placement.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <glob.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+struct NodeStats {
+    size_t ranges = 0;
+    size_t bytes = 0;
+    size_t unbound_bytes = 0;   // Bytes requested on the node but left to the default policy
+};
+
+struct NumaAllocation {
+    int node;
+    size_t size;
+    bool bound;
+};
+
+// libnuma is loaded at runtime so that the library neither requires it at build time nor at load time.
+struct LibNuma {
+    void *handle = nullptr;
+    int (*available)() = nullptr;
+    void (*tonode_memory)(void *, size_t, int) = nullptr;
+};
+
+static std::mutex numa_mutex;
+static bool numa_enabled = true;
+static std::string numa_topology_arg;
+static std::string numa_sysfs_root = "/sys";
+static std::vector<int> device_nodes;
+static LibNuma libnuma;
+static std::map<void *, NumaAllocation> numa_allocations;
+static std::map<int, NodeStats> numa_node_stats;
+
+static bool parse_topology(const std::string &text, std::vector<int> &nodes) {
+    nodes.clear();
+    for (const auto &item : split_list(text, ',')) {
+        if (item.empty()) continue;
+        std::vector<std::string> fields = split_list(item, ':');
+        if (fields.size() != 2) return false;
+        char *end = nullptr;
+        long device = strtol(fields[0].c_str(), &end, 10);
+        if (end == fields[0].c_str() || *end != '\0' || device < 0) return false;
+        long node = strtol(fields[1].c_str(), &end, 10);
+        if (end == fields[1].c_str() || *end != '\0' || node < -1) return false;
+        if (nodes.size() <= static_cast<size_t>(device)) nodes.resize(device + 1, -1);
+        nodes[device] = static_cast<int>(node);
+    }
+    return !nodes.empty();
+}
+
+#if defined(__linux__)
+static int read_device_node_from_sysfs(size_t device) {
+    // The DX-RT driver exposes device N as dxrtN; its PCI parent reports the local node.
+    std::string pattern = numa_sysfs_root + "/class/*/dxrt" + std::to_string(device) + "/device/numa_node";
+    glob_t matches;
+    int node = -1;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+        if (matches.gl_pathc > 0) {
+            std::ifstream f(matches.gl_pathv[0]);
+            if (!(f >> node)) node = -1;
+        }
+        globfree(&matches);
+    }
+    return node;
+}
+
+static void load_libnuma() {
+    if (libnuma.handle) return;
+    void *handle = dlopen("libnuma.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        spdlog::info("libnuma not found, output buffers use the default memory policy");
+        return;
+    }
+    libnuma.available = reinterpret_cast<int (*)()>(dlsym(handle, "numa_available"));
+    libnuma.tonode_memory = reinterpret_cast<void (*)(void *, size_t, int)>(dlsym(handle, "numa_tonode_memory"));
+    if (!libnuma.available || !libnuma.tonode_memory || libnuma.available() < 0) {
+        spdlog::info("NUMA is not available on this system, output buffers use the default memory policy");
+        dlclose(handle);
+        libnuma = LibNuma();
+        return;
+    }
+    libnuma.handle = handle;
+}
+#endif
+
+bool numa_placement_parse_arg(const char *key, const void *value) {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    if (strcmp(key, "numa_topology") == 0) {
+        numa_topology_arg = static_cast<const char *>(value);
+        return true;
+    }
+    if (strcmp(key, "numa_sysfs_root") == 0) {
+        numa_sysfs_root = static_cast<const char *>(value);
+        return true;
+    }
+    if (strcmp(key, "numa_enable") == 0) {
+        numa_enabled = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    return false;
+}
+
+void numa_placement_init(size_t num_devices) {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    device_nodes.assign(num_devices, -1);
+    if (!numa_enabled) {
+        spdlog::info("NUMA-aware allocation disabled");
+        return;
+    }
+
+    if (!numa_topology_arg.empty()) {
+        std::vector<int> nodes;
+        if (parse_topology(numa_topology_arg, nodes)) {
+            for (size_t i = 0; i < num_devices && i < nodes.size(); i++) device_nodes[i] = nodes[i];
+        } else {
+            spdlog::warn("Ignoring invalid numa_topology '{}'", numa_topology_arg);
+        }
+    }
+#if defined(__linux__)
+    else {
+        for (size_t i = 0; i < num_devices; i++) device_nodes[i] = read_device_node_from_sysfs(i);
+    }
+    load_libnuma();
+#endif
+
+    for (size_t i = 0; i < num_devices; i++) {
+        spdlog::info("Device {} is attached to NUMA node {}", i, device_nodes[i]);
+    }
+}
+
+int numa_node_of_device(size_t device) {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    return device < device_nodes.size() ? device_nodes[device] : -1;
+}
+
+std::vector<int> numa_device_nodes() {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    std::vector<int> nodes;
+    for (int node : device_nodes) {
+        if (node >= 0 && std::find(nodes.begin(), nodes.end(), node) == nodes.end()) nodes.push_back(node);
+    }
+    return nodes;
+}
+
+std::vector<int> numa_node_cpus(int node) {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    if (node < 0) return cpus;
+    std::string root;
+    {
+        std::lock_guard<std::mutex> lock(numa_mutex);
+        root = numa_sysfs_root;
+    }
+    std::ifstream f(root + "/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string text;
+    if (f >> text) parse_cpu_list(text, cpus);
+#else
+    (void)node;
+#endif
+    return cpus;
+}
+
+bool numa_bind_memory(void *ptr, size_t size, int node) {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    bool bound = false;
+    if (node >= 0 && libnuma.handle) {
+        libnuma.tonode_memory(ptr, size, node);
+        bound = true;
+    }
+
+    numa_allocations[ptr] = NumaAllocation{node, size, bound};
+    NodeStats &stats = numa_node_stats[node];
+    stats.ranges++;
+    stats.bytes += size;
+    if (!bound) stats.unbound_bytes += size;
+    return bound;
+}
+
+void numa_release_memory(void *ptr) {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    auto it = numa_allocations.find(ptr);
+    if (it == numa_allocations.end()) return;
+
+    NodeStats &stats = numa_node_stats[it->second.node];
+    stats.ranges--;
+    stats.bytes -= it->second.size;
+    if (!it->second.bound) stats.unbound_bytes -= it->second.size;
+    numa_allocations.erase(it);
+}
+
+std::string numa_stats_json() {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    std::ostringstream out;
+    out << "{\"libnuma\":" << (libnuma.handle ? "true" : "false") << ",\"nodes\":[";
+    bool first = true;
+    for (const auto &entry : numa_node_stats) {
+        if (!first) out << ",";
+        first = false;
+        out << "{\"node\":" << entry.first << ",\"ranges\":" << entry.second.ranges
+            << ",\"bytes\":" << entry.second.bytes << ",\"unbound_bytes\":" << entry.second.unbound_bytes << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+void numa_placement_reset() {
+    std::lock_guard<std::mutex> lock(numa_mutex);
+    numa_enabled = true;
+    numa_topology_arg.clear();
+    numa_sysfs_root = "/sys";
+    device_nodes.clear();
+    if (!numa_allocations.empty()) return;
+    numa_node_stats.clear();
+#if defined(__linux__)
+    if (libnuma.handle) {
+        dlclose(libnuma.handle);
+        libnuma = LibNuma();
+    }
+#endif
+}
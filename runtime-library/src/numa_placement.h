@@ -0,0 +1,68 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Consumes an initialization argument if it is a NUMA placement key.
+ *
+ * Supported keys:
+ *  - "numa_topology" (string): device to node mapping such as "0:0,1:0,2:1,3:1". When set, it
+ *    replaces the topology read from sysfs, which also allows describing a fake topology.
+ *  - "numa_sysfs_root" (string): directory the device nodes and node CPU lists are read from
+ *    instead of "/sys", so that a fake sysfs tree can stand in for the real topology.
+ *  - "numa_enable" (int): 0 disables NUMA-aware allocation altogether.
+ *
+ * @return true if the key was consumed, false otherwise.
+ */
+bool numa_placement_parse_arg(const char *key, const void *value);
+
+/**
+ * @brief Resolves the NUMA node of each device and loads libnuma if it is available.
+ *
+ * @param num_devices The number of DX devices reported by dxrt.
+ */
+void numa_placement_init(size_t num_devices);
+
+/**
+ * @return The NUMA node local to the device, or -1 if it is unknown.
+ */
+int numa_node_of_device(size_t device);
+
+/**
+ * @return The distinct NUMA nodes the devices are attached to, empty if unknown.
+ */
+std::vector<int> numa_device_nodes();
+
+/**
+ * @return The CPUs belonging to the NUMA node, empty if unknown.
+ */
+std::vector<int> numa_node_cpus(int node);
+
+/**
+ * @brief Binds a not yet faulted-in memory range to the NUMA node and accounts it in the statistics.
+ *
+ * The range is left to the default policy when the node is unknown or libnuma is absent.
+ *
+ * @return true if the range was bound to the node, false otherwise.
+ */
+bool numa_bind_memory(void *ptr, size_t size, int node);
+
+/**
+ * @brief Removes a range registered with numa_bind_memory() from the statistics before it is freed.
+ */
+void numa_release_memory(void *ptr);
+
+/**
+ * @return The per-node allocation statistics as a JSON object.
+ */
+std::string numa_stats_json();
+
+/**
+ * @brief Clears the topology and configuration.
+ */
+void numa_placement_reset();
+
+#endif // NUMA_PLACEMENT_H
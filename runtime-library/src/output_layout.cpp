@@ -0,0 +1,139 @@
+#include "output_layout.h"
+
+#include <algorithm>
+#include <string.h>
+
+// 64x64 elements of up to 4 bytes fit a 16 KiB source and destination tile in L1.
+static const size_t TILE = 64;
+
+bool output_layout_parse(const char *text, LayoutConversion &conversion) {
+    if (strcmp(text, "native") == 0) {
+        conversion = LayoutConversion::NONE;
+    } else if (strcmp(text, "nchw") == 0) {
+        conversion = LayoutConversion::NHWC_TO_NCHW;
+    } else if (strcmp(text, "nhwc") == 0) {
+        conversion = LayoutConversion::NCHW_TO_NHWC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool output_layout_init(const std::vector<int64_t> &shape, size_t elem_size, size_t device_size,
+                        LayoutConversion conversion, OutputLayout &layout) {
+    layout = OutputLayout();
+    if (shape.empty() || elem_size == 0) return false;
+
+    size_t rows = 1;
+    for (size_t d = 0; d + 1 < shape.size(); d++) {
+        if (shape[d] <= 0) return false;
+        rows *= static_cast<size_t>(shape[d]);
+    }
+    if (shape.back() <= 0) return false;
+    size_t row_elems = static_cast<size_t>(shape.back());
+
+    // Padding is only recognized when the device buffer holds whole padded rows.
+    size_t row_bytes = device_size / rows;
+    if (row_bytes * rows != device_size || row_bytes % elem_size != 0 || row_bytes / elem_size < row_elems) {
+        return false;
+    }
+
+    layout.elem_size = elem_size;
+    layout.rows = rows;
+    layout.row_elems = row_elems;
+    layout.row_stride = row_bytes / elem_size;
+    // Transposes are implemented for the power-of-two element sizes of plain numeric types.
+    bool transposable = elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8;
+    if (shape.size() == 4 && transposable) {
+        layout.conversion = conversion;
+        std::copy(shape.begin(), shape.end(), layout.dims);
+    }
+    return layout.row_stride != layout.row_elems || layout.conversion != LayoutConversion::NONE;
+}
+
+void output_layout_shape(const OutputLayout &layout, std::vector<int64_t> &shape) {
+    if (layout.conversion == LayoutConversion::NHWC_TO_NCHW) {
+        shape = {layout.dims[0], layout.dims[3], layout.dims[1], layout.dims[2]};
+    } else if (layout.conversion == LayoutConversion::NCHW_TO_NHWC) {
+        shape = {layout.dims[0], layout.dims[2], layout.dims[3], layout.dims[1]};
+    }
+}
+
+// dst[c * dst_stride + r] = src[r * src_stride + c], tile by tile so that both sides stay in cache.
+template <typename T>
+static void transpose(const T *src, size_t src_stride, T *dst, size_t dst_stride, size_t rows, size_t cols) {
+    for (size_t r0 = 0; r0 < rows; r0 += TILE) {
+        size_t r1 = std::min(rows, r0 + TILE);
+        for (size_t c0 = 0; c0 < cols; c0 += TILE) {
+            size_t c1 = std::min(cols, c0 + TILE);
+            for (size_t r = r0; r < r1; r++) {
+                const T *in = src + r * src_stride;
+                for (size_t c = c0; c < c1; c++) {
+                    dst[c * dst_stride + r] = in[c];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+static void unpack(const T *src, T *dst, const OutputLayout &layout) {
+    size_t n = static_cast<size_t>(layout.dims[0]);
+    switch (layout.conversion) {
+    case LayoutConversion::NHWC_TO_NCHW: {
+        // Per batch, an (H * W) x C matrix of padded rows becomes C x (H * W).
+        size_t h = static_cast<size_t>(layout.dims[1]);
+        size_t w = static_cast<size_t>(layout.dims[2]);
+        size_t c = layout.row_elems;
+        for (size_t b = 0; b < n; b++) {
+            transpose(src + b * h * w * layout.row_stride, layout.row_stride, dst + b * c * h * w, h * w, h * w, c);
+        }
+        break;
+    }
+    case LayoutConversion::NCHW_TO_NHWC: {
+        // Per batch and row, a C x W matrix with padded rows becomes W x C.
+        size_t c = static_cast<size_t>(layout.dims[1]);
+        size_t h = static_cast<size_t>(layout.dims[2]);
+        size_t w = layout.row_elems;
+        for (size_t b = 0; b < n; b++) {
+            for (size_t y = 0; y < h; y++) {
+                const T *in = src + (b * c * h + y) * layout.row_stride;
+                transpose(in, h * layout.row_stride, dst + (b * h + y) * w * c, c, c, w);
+            }
+        }
+        break;
+    }
+    default:
+        for (size_t r = 0; r < layout.rows; r++) {
+            memcpy(dst + r * layout.row_elems, src + r * layout.row_stride, layout.row_elems * sizeof(T));
+        }
+        break;
+    }
+}
+
+void output_layout_unpack(const void *src, void *dst, const OutputLayout &layout) {
+    switch (layout.elem_size) {
+    case 1:
+        unpack(static_cast<const uint8_t *>(src), static_cast<uint8_t *>(dst), layout);
+        break;
+    case 2:
+        unpack(static_cast<const uint16_t *>(src), static_cast<uint16_t *>(dst), layout);
+        break;
+    case 4:
+        unpack(static_cast<const uint32_t *>(src), static_cast<uint32_t *>(dst), layout);
+        break;
+    case 8:
+        unpack(static_cast<const uint64_t *>(src), static_cast<uint64_t *>(dst), layout);
+        break;
+    default: {
+        // Other element sizes are only stripped of their padding.
+        const uint8_t *in = static_cast<const uint8_t *>(src);
+        uint8_t *out = static_cast<uint8_t *>(dst);
+        size_t row_bytes = layout.row_elems * layout.elem_size;
+        for (size_t r = 0; r < layout.rows; r++) {
+            memcpy(out + r * row_bytes, in + r * layout.row_stride * layout.elem_size, row_bytes);
+        }
+        break;
+    }
+    }
+}
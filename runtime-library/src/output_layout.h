@@ -0,0 +1,56 @@
+#ifndef OUTPUT_LAYOUT_H
+#define OUTPUT_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum class LayoutConversion {
+    NONE,
+    NHWC_TO_NCHW,
+    NCHW_TO_NHWC,
+};
+
+/**
+ * @brief How an output is unpacked from the device buffer into its logical layout.
+ *
+ * The device may pad the innermost dimension of each row to an alignment boundary. Rows are stripped
+ * of that padding, and rank-4 outputs are optionally transposed, in the same pass.
+ */
+struct OutputLayout {
+    size_t elem_size = 0;
+    size_t rows = 0;            // Product of all dimensions but the innermost one
+    size_t row_elems = 0;       // Innermost dimension
+    size_t row_stride = 0;      // Innermost dimension including the device padding, in elements
+    LayoutConversion conversion = LayoutConversion::NONE;
+    int64_t dims[4] = {0, 0, 0, 0}; // Source dimensions of a transposed output
+};
+
+/**
+ * @brief Parses the "output_layout" initialization argument: "native", "nchw" or "nhwc".
+ *
+ * "nchw" converts rank-4 outputs the device returns in NHWC, and "nhwc" the opposite.
+ *
+ * @return false if the value is unknown.
+ */
+bool output_layout_parse(const char *text, LayoutConversion &conversion);
+
+/**
+ * @brief Derives the unpacking of an output from its shape and the size of its device buffer.
+ *
+ * @return true if the output needs unpacking, false if it can be copied as is.
+ */
+bool output_layout_init(const std::vector<int64_t> &shape, size_t elem_size, size_t device_size,
+                        LayoutConversion conversion, OutputLayout &layout);
+
+/**
+ * @brief Rewrites the shape of an output to the layout it is returned in.
+ */
+void output_layout_shape(const OutputLayout &layout, std::vector<int64_t> &shape);
+
+/**
+ * @brief Unpacks an output into dst, touching each element once.
+ */
+void output_layout_unpack(const void *src, void *dst, const OutputLayout &layout);
+
+#endif // OUTPUT_LAYOUT_H
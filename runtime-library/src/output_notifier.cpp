@@ -0,0 +1,90 @@
+#include "output_notifier.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+OutputNotifier::~OutputNotifier() {
+    close();
+}
+
+bool OutputNotifier::open() {
+    if (read_fd_ >= 0) {
+        return true;
+    }
+#if defined(__linux__)
+    read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_fd_ < 0) {
+        spdlog::error("[OutputNotifier] Failed to create an eventfd: errno {}", errno);
+        return false;
+    }
+    write_fd_ = read_fd_;
+#elif defined(__unix__) || defined(__APPLE__)
+    int fds[2];
+    if (pipe(fds) != 0) {
+        spdlog::error("[OutputNotifier] Failed to create a pipe: errno {}", errno);
+        return false;
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+#else
+    spdlog::error("[OutputNotifier] Output notification is not supported on this platform");
+    return false;
+#endif
+    signaled_ = false;
+    return true;
+}
+
+void OutputNotifier::close() {
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+    if (write_fd_ >= 0 && write_fd_ != read_fd_) {
+        ::close(write_fd_);
+    }
+    if (read_fd_ >= 0) {
+        ::close(read_fd_);
+    }
+#endif
+    read_fd_ = -1;
+    write_fd_ = -1;
+    signaled_ = false;
+}
+
+// The descriptor holds at most one token, written by set() and consumed by clear().
+void OutputNotifier::set() {
+    if (write_fd_ < 0 || signaled_) {
+        return;
+    }
+#if defined(__linux__)
+    uint64_t one = 1;
+    signaled_ = write(write_fd_, &one, sizeof(one)) == sizeof(one);
+#elif defined(__unix__) || defined(__APPLE__)
+    char token = 0;
+    signaled_ = write(write_fd_, &token, 1) == 1;
+#endif
+}
+
+void OutputNotifier::clear() {
+    if (read_fd_ < 0 || !signaled_) {
+        return;
+    }
+#if defined(__linux__)
+    uint64_t count;
+    signaled_ = read(read_fd_, &count, sizeof(count)) != sizeof(count);
+#elif defined(__unix__) || defined(__APPLE__)
+    char token;
+    signaled_ = read(read_fd_, &token, 1) != 1;
+#endif
+}
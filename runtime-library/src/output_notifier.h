@@ -0,0 +1,45 @@
+#ifndef OUTPUT_NOTIFIER_H
+#define OUTPUT_NOTIFIER_H
+
+/**
+ * @brief A file descriptor that is readable while outputs are waiting to be received.
+ *
+ * Backed by an eventfd on Linux and by a non-blocking pipe on other POSIX systems. The owner keeps it
+ * level-triggered by calling set() when its queue becomes non-empty and clear() when it becomes empty,
+ * with the queue lock held, so the descriptor's readiness always mirrors the queue.
+ */
+class OutputNotifier {
+public:
+    OutputNotifier() = default;
+    ~OutputNotifier();
+
+    OutputNotifier(const OutputNotifier &) = delete;
+    OutputNotifier &operator=(const OutputNotifier &) = delete;
+
+    /**
+     * @brief Creates the descriptor if it does not exist yet.
+     *
+     * @return false if the platform has no suitable descriptor or its creation failed.
+     */
+    bool open();
+
+    /**
+     * @brief Closes the descriptor.
+     */
+    void close();
+
+    /**
+     * @return The descriptor to poll for readability, or -1 if it is not open.
+     */
+    int fd() const { return read_fd_; }
+
+    void set();
+    void clear();
+
+private:
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+    bool signaled_ = false;
+};
+
+#endif // OUTPUT_NOTIFIER_H
@@ -0,0 +1,438 @@
+#include "output_pool.h"
+#include "numa_placement.h"
+
+extern "C" {
+#include "tensors_struct.h"
+}
+
+#include <algorithm>
+#include <errno.h>
+#include <map>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+static const size_t SLOT_ALIGNMENT = 4096;
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static const char *huge_page_mode_name(HugePageMode mode) {
+    switch (mode) {
+    case HugePageMode::TRANSPARENT:
+        return "transparent";
+    case HugePageMode::EXPLICIT:
+        return "explicit";
+    default:
+        return "none";
+    }
+}
+
+OutputPool::~OutputPool() {
+    destroy();
+}
+
+bool OutputPool::allocate_slab(Slab &slab) const {
+    const OutputPoolOptions &options = options_;
+    if (has_custom_tensors_allocator()) {
+        // Host memory already has its placement; huge pages, binding and locking are up to the host.
+        slab.base = static_cast<uint8_t *>(tensors_aligned_malloc(SLOT_ALIGNMENT, slab.bytes));
+        if (!slab.base) {
+            spdlog::error("The tensors allocator failed to allocate an output slab of {} bytes", slab.bytes);
+            return false;
+        }
+        slab.host_allocated = true;
+        numa_bind_memory(slab.base, slab.bytes, -1);
+        if (options.prefault) memset(slab.base, 0, slab.bytes);
+        return true;
+    }
+#if defined(__linux__)
+    if (options.huge_pages == HugePageMode::EXPLICIT) {
+        size_t bytes = round_up(slab.bytes, HUGE_PAGE_SIZE);
+        void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            slab.base = static_cast<uint8_t *>(ptr);
+            slab.bytes = bytes;
+            slab.huge = true;
+        } else {
+            spdlog::warn("Failed to map {} bytes of explicit huge pages ({}), falling back to regular pages",
+                         bytes, strerror(errno));
+        }
+    }
+    if (!slab.base) {
+        void *ptr = mmap(nullptr, slab.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            spdlog::error("Failed to map output slab of {} bytes: {}", slab.bytes, strerror(errno));
+            return false;
+        }
+        slab.base = static_cast<uint8_t *>(ptr);
+        if (options.huge_pages == HugePageMode::TRANSPARENT) {
+            slab.huge = madvise(ptr, slab.bytes, MADV_HUGEPAGE) == 0;
+        }
+    }
+
+    // The node policy must be in place before the pages are faulted in.
+    numa_bind_memory(slab.base, slab.bytes, slab.node);
+
+    if (options.prefault) {
+        size_t page = slab.huge ? HUGE_PAGE_SIZE : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        for (size_t offset = 0; offset < slab.bytes; offset += page) {
+            slab.base[offset] = 0;
+        }
+    }
+    if (options.lock) {
+        slab.locked = mlock(slab.base, slab.bytes) == 0;
+        if (!slab.locked) {
+            spdlog::warn("Failed to mlock output slab of {} bytes: {}", slab.bytes, strerror(errno));
+        }
+    }
+#else
+#if defined(_WIN32)
+    slab.base = static_cast<uint8_t *>(_aligned_malloc(slab.bytes, SLOT_ALIGNMENT));
+#else
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, SLOT_ALIGNMENT, slab.bytes) == 0) slab.base = static_cast<uint8_t *>(ptr);
+#endif
+    if (!slab.base) {
+        spdlog::error("Failed to allocate output slab of {} bytes", slab.bytes);
+        return false;
+    }
+    numa_bind_memory(slab.base, slab.bytes, slab.node);
+    if (options.prefault) memset(slab.base, 0, slab.bytes);
+#endif
+    return true;
+}
+
+void OutputPool::free_slab(Slab &slab) {
+    if (!slab.base) return;
+    numa_release_memory(slab.base);
+    if (slab.host_allocated) {
+        tensors_free(slab.base);
+        slab = Slab();
+        return;
+    }
+#if defined(__linux__)
+    if (slab.locked) munlock(slab.base, slab.bytes);
+    munmap(slab.base, slab.bytes);
+#elif defined(_WIN32)
+    _aligned_free(slab.base);
+#else
+    free(slab.base);
+#endif
+    slab = Slab();
+}
+
+std::vector<OutputPool::Slab> OutputPool::plan_slabs(size_t count, size_t &bytes) const {
+    // Assign the new slots to the devices' nodes round-robin and group them into one slab per node.
+    std::map<int, uint32_t> slots_per_node;
+    for (size_t i = 0; i < count; i++) {
+        int node = device_nodes_.empty() ? -1 : device_nodes_[(next_device_ + i) % device_nodes_.size()];
+        slots_per_node[node]++;
+    }
+
+    std::vector<Slab> planned;
+    bytes = 0;
+    for (const auto &entry : slots_per_node) {
+        Slab slab;
+        slab.node = entry.first;
+        slab.num_slots = entry.second;
+        slab.bytes = slot_stride_ * entry.second;
+        if (options_.huge_pages != HugePageMode::NONE) slab.bytes = round_up(slab.bytes, HUGE_PAGE_SIZE);
+        bytes += slab.bytes;
+        planned.push_back(slab);
+    }
+    return planned;
+}
+
+size_t OutputPool::allocate_slabs(std::vector<Slab> &planned) {
+    size_t slots = 0;
+    std::vector<Slab> allocated;
+    for (auto &slab : planned) {
+        if (!allocate_slab(slab)) continue;
+        slots += slab.num_slots;
+        allocated.push_back(slab);
+    }
+    planned.swap(allocated);
+    return slots;
+}
+
+void OutputPool::add_slabs(std::vector<Slab> &allocated, bool grown) {
+    for (auto &slab : allocated) {
+        slab.first_slot = next_slot_;
+        slab.free_slots = slab.num_slots;
+        slab.grown = grown;
+        next_slot_ += slab.num_slots;
+        bytes_ += slab.bytes;
+
+        // Push in reverse so that low indices are handed out first and a lightly loaded pool keeps
+        // touching the same slots.
+        for (uint32_t i = slab.num_slots; i > 0; i--) free_slots_.push_back(slab.first_slot + i - 1);
+        next_device_ += slab.num_slots;
+        slabs_.push_back(slab);
+
+        spdlog::info("Output slab: node={} slots={} stride={} bytes={} huge_pages={} locked={} grown={}", slab.node,
+                     slab.num_slots, slot_stride_, slab.bytes,
+                     slab.huge ? huge_page_mode_name(options_.huge_pages) : "none", slab.locked, grown);
+    }
+    high_water_bytes_ = std::max(high_water_bytes_, bytes_);
+}
+
+bool OutputPool::init(size_t slot_size, const std::vector<int> &device_nodes, const OutputPoolOptions &options) {
+    destroy();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = false;
+    options_ = options;
+    device_nodes_ = device_nodes;
+    next_device_ = 0;
+    next_slot_ = 0;
+    slot_stride_ = round_up(std::max<size_t>(slot_size, 1), SLOT_ALIGNMENT);
+    if (options_.max_slots < options_.min_slots) options_.max_slots = options_.min_slots;
+    if (options_.grow_slots == 0) options_.grow_slots = std::max<size_t>(device_nodes_.size(), 1);
+    bytes_ = high_water_bytes_ = 0;
+    grow_events_ = shrink_events_ = budget_refusals_ = grow_failures_ = starvation_waits_ = 0;
+    last_starvation_ = std::chrono::steady_clock::now();
+
+    size_t count = options_.min_slots;
+    size_t bytes = 0;
+    std::vector<Slab> planned = plan_slabs(count, bytes);
+    while (options_.max_bytes > 0 && count > 1 && bytes > options_.max_bytes) {
+        planned = plan_slabs(--count, bytes);
+    }
+    if (options_.max_bytes > 0 && bytes > options_.max_bytes) {
+        spdlog::error("Output pool budget of {} bytes does not fit a single slab of {} bytes", options_.max_bytes,
+                      bytes);
+        return false;
+    }
+    if (count < options_.min_slots) {
+        spdlog::warn("Output pool budget of {} bytes only fits {} of the {} minimum slots", options_.max_bytes, count,
+                     options_.min_slots);
+        options_.min_slots = count;
+    }
+
+    allocate_slabs(planned);
+    add_slabs(planned, false);
+    cv_.notify_all();
+    return !free_slots_.empty();
+}
+
+void OutputPool::destroy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &slab : slabs_) free_slab(slab);
+    slabs_.clear();
+    free_slots_.clear();
+    slot_stride_ = 0;
+    bytes_ = 0;
+}
+
+OutputPool::Slab *OutputPool::find_slab(uint32_t index) {
+    for (auto &slab : slabs_) {
+        if (index >= slab.first_slot && index < slab.first_slot + slab.num_slots) return &slab;
+    }
+    return nullptr;
+}
+
+void *OutputPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool starved = false;
+    while (!shutdown_ && free_slots_.empty()) {
+        last_starvation_ = std::chrono::steady_clock::now();
+
+        size_t capacity = 0;
+        for (const auto &slab : slabs_) capacity += slab.num_slots;
+        size_t count = std::min(options_.grow_slots, options_.max_slots > capacity ? options_.max_slots - capacity : 0);
+
+        if (!growing_ && count > 0) {
+            size_t bytes = 0;
+            std::vector<Slab> planned = plan_slabs(count, bytes);
+            while (options_.max_bytes > 0 && count > 0 && bytes_ + bytes > options_.max_bytes) {
+                planned = plan_slabs(--count, bytes);
+            }
+            if (count == 0) {
+                budget_refusals_++;
+            } else {
+                // Map and fault in the new slab without blocking the threads releasing slots.
+                growing_ = true;
+                lock.unlock();
+                allocate_slabs(planned);
+                lock.lock();
+                growing_ = false;
+                if (shutdown_) {
+                    for (auto &slab : planned) free_slab(slab);
+                    break;
+                }
+                if (!planned.empty()) {
+                    add_slabs(planned, true);
+                    grow_events_++;
+                    cv_.notify_all();
+                    continue;
+                }
+                // Retrying the allocation right away would spin; wait for a slot like a refused growth.
+                grow_failures_++;
+            }
+        }
+
+        if (!starved) {
+            starved = true;
+            starvation_waits_++;
+        }
+        cv_.wait(lock);
+    }
+    if (shutdown_) return nullptr;
+
+    uint32_t index = free_slots_.back();
+    free_slots_.pop_back();
+    Slab *slab = find_slab(index);
+    slab->free_slots--;
+    void *slot = slab->base + (index - slab->first_slot) * slot_stride_;
+    if (!starved) try_shrink();
+    return slot;
+}
+
+void OutputPool::try_shrink() {
+    if (shutdown_ || growing_) return;
+    auto idle = std::chrono::steady_clock::now() - last_starvation_;
+    if (idle < std::chrono::milliseconds(options_.shrink_idle_ms)) return;
+
+    size_t capacity = 0;
+    for (const auto &slab : slabs_) capacity += slab.num_slots;
+
+    // Release the most recently grown slab first, one per call.
+    for (size_t i = slabs_.size(); i > 0; i--) {
+        Slab &slab = slabs_[i - 1];
+        if (!slab.grown || slab.free_slots != slab.num_slots) continue;
+        if (capacity - slab.num_slots < options_.min_slots) return;
+
+        uint32_t first = slab.first_slot;
+        uint32_t last = slab.first_slot + slab.num_slots;
+        free_slots_.erase(std::remove_if(free_slots_.begin(), free_slots_.end(),
+                                         [first, last](uint32_t index) { return index >= first && index < last; }),
+                          free_slots_.end());
+        spdlog::info("Releasing idle output slab: node={} slots={} bytes={}", slab.node, slab.num_slots, slab.bytes);
+        bytes_ -= slab.bytes;
+        free_slab(slab);
+        slabs_.erase(slabs_.begin() + (i - 1));
+        shrink_events_++;
+        return;
+    }
+}
+
+void OutputPool::release(void *slot) {
+    if (!slot) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint8_t *ptr = static_cast<const uint8_t *>(slot);
+        Slab *owner = nullptr;
+        for (auto &slab : slabs_) {
+            if (ptr >= slab.base && ptr < slab.base + slab.num_slots * slot_stride_) {
+                owner = &slab;
+                break;
+            }
+        }
+        if (!owner) {
+            spdlog::error("Released buffer {} does not belong to the output pool", slot);
+            return;
+        }
+        free_slots_.push_back(static_cast<uint32_t>(owner->first_slot + (ptr - owner->base) / slot_stride_));
+        owner->free_slots++;
+        try_shrink();
+    }
+    cv_.notify_one();
+}
+
+void OutputPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    cv_.notify_all();
+}
+
+size_t OutputPool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t slots = 0;
+    for (const auto &slab : slabs_) slots += slab.num_slots;
+    return slots;
+}
+
+size_t OutputPool::available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_slots_.size();
+}
+
+std::string OutputPool::stats_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t slots = 0;
+    size_t huge_bytes = 0;
+    size_t locked_bytes = 0;
+    for (const auto &slab : slabs_) {
+        slots += slab.num_slots;
+        if (slab.huge) huge_bytes += slab.bytes;
+        if (slab.locked) locked_bytes += slab.bytes;
+    }
+    std::ostringstream out;
+    out << "{\"slots\":" << slots << ",\"free_slots\":" << free_slots_.size() << ",\"min_slots\":" << options_.min_slots
+        << ",\"max_slots\":" << options_.max_slots << ",\"slot_bytes\":" << slot_stride_ << ",\"slabs\":" << slabs_.size()
+        << ",\"bytes\":" << bytes_ << ",\"high_water_bytes\":" << high_water_bytes_
+        << ",\"budget_bytes\":" << options_.max_bytes << ",\"huge_page_bytes\":" << huge_bytes
+        << ",\"locked_bytes\":" << locked_bytes << ",\"grow_events\":" << grow_events_
+        << ",\"shrink_events\":" << shrink_events_ << ",\"budget_refusals\":" << budget_refusals_
+        << ",\"grow_failures\":" << grow_failures_        << ",\"starvation_waits\":" << starvation_waits_ << "}";
+    return out.str();
+}
+
+bool output_pool_parse_arg(const char *key, const void *value, OutputPoolOptions &options) {
+    if (strcmp(key, "output_pool_huge_pages") == 0) {
+        const char *mode = static_cast<const char *>(value);
+        if (strcmp(mode, "transparent") == 0) {
+            options.huge_pages = HugePageMode::TRANSPARENT;
+        } else if (strcmp(mode, "explicit") == 0) {
+            options.huge_pages = HugePageMode::EXPLICIT;
+        } else if (strcmp(mode, "none") == 0) {
+            options.huge_pages = HugePageMode::NONE;
+        } else {
+            spdlog::warn("Ignoring invalid output_pool_huge_pages '{}'", mode);
+        }
+        return true;
+    }
+    if (strcmp(key, "output_pool_prefault") == 0) {
+        options.prefault = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    if (strcmp(key, "output_pool_mlock") == 0) {
+        options.lock = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    if (strcmp(key, "output_pool_min_slots") == 0) {
+        options.min_slots = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    if (strcmp(key, "output_pool_max_slots") == 0) {
+        options.max_slots = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0));
+        return true;
+    }
+    if (strcmp(key, "output_pool_grow_slots") == 0) {
+        options.grow_slots = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0));
+        return true;
+    }
+    if (strcmp(key, "output_pool_max_mb") == 0) {
+        options.max_bytes = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0)) * 1024 * 1024;
+        return true;
+    }
+    if (strcmp(key, "output_pool_shrink_idle_ms") == 0) {
+        options.shrink_idle_ms = static_cast<unsigned>(std::max(*static_cast<const int *>(value), 0));
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,141 @@
+#ifndef OUTPUT_POOL_H
+#define OUTPUT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class HugePageMode {
+    NONE,           // Regular pages
+    TRANSPARENT,    // madvise(MADV_HUGEPAGE) on the slab
+    EXPLICIT,       // MAP_HUGETLB from the hugetlbfs reserve, falls back to regular pages
+};
+
+struct OutputPoolOptions {
+    HugePageMode huge_pages = HugePageMode::NONE;
+    bool prefault = true;   // Fault every page in at load time instead of on the first inference
+    bool lock = false;      // mlock the slabs so they are never paged out
+
+    size_t min_slots = 0;           // Slots allocated at load and never released, 0 for the runtime default
+    size_t max_slots = 0;           // Upper bound when growing, 0 to keep the pool at min_slots
+    size_t grow_slots = 0;          // Slots added per growth step, 0 for one per device
+    size_t max_bytes = 0;           // Hard budget for all slabs, 0 for no budget
+    unsigned shrink_idle_ms = 10000; // Grown slabs are released after this long without starvation
+};
+
+/**
+ * @brief Fixed-size output buffers carved out of aligned slabs, one per NUMA node and growth step.
+ *
+ * Slabs come from the host's tensors_allocator when one is installed, and are mapped by the pool
+ * otherwise.
+ *
+ * Slots are handed out from an index free-list. When the pool runs dry, acquire() grows it by
+ * grow_slots up to max_slots and max_bytes, and otherwise blocks until a slot is released or the
+ * pool is shut down. A growth step that fails to allocate also blocks until the next release.
+ * Slabs added by growth are released again once they are entirely free and no acquire() had to
+ * wait for shrink_idle_ms; this is checked on every acquire() and release().
+ */
+class OutputPool {
+public:
+    OutputPool() = default;
+    ~OutputPool();
+
+    OutputPool(const OutputPool &) = delete;
+    OutputPool &operator=(const OutputPool &) = delete;
+
+    /**
+     * @brief Allocates the initial min_slots slots.
+     *
+     * @param slot_size The size of each buffer in bytes.
+     * @param device_nodes The NUMA node of each device (-1 for unknown). Slots are assigned to the
+     *                     devices' nodes round-robin.
+     * @return true if at least one slot could be allocated, false also if max_bytes is too small to
+     *         hold a single slot.
+     */
+    bool init(size_t slot_size, const std::vector<int> &device_nodes, const OutputPoolOptions &options);
+
+    /**
+     * @brief Releases the slabs. Outstanding slots become invalid.
+     */
+    void destroy();
+
+    /**
+     * @return A free slot, or nullptr if the pool was shut down while waiting.
+     */
+    void *acquire();
+
+    /**
+     * @brief Returns a slot obtained from acquire() to the pool.
+     */
+    void release(void *slot);
+
+    /**
+     * @brief Wakes up all threads blocked in acquire() and makes them return nullptr.
+     */
+    void shutdown();
+
+    size_t capacity() const;
+    size_t available() const;
+
+    /**
+     * @return The pool statistics as a JSON object.
+     */
+    std::string stats_json() const;
+
+private:
+    struct Slab {
+        uint8_t *base = nullptr;
+        size_t bytes = 0;
+        int node = -1;
+        uint32_t first_slot = 0;
+        uint32_t num_slots = 0;
+        uint32_t free_slots = 0;
+        bool grown = false;     // Added on starvation, may be released when idle
+        bool huge = false;
+        bool locked = false;
+        bool host_allocated = false;    // From the host's tensors_allocator
+    };
+
+    bool allocate_slab(Slab &slab) const;
+    void free_slab(Slab &slab);
+    std::vector<Slab> plan_slabs(size_t count, size_t &bytes) const;
+    size_t allocate_slabs(std::vector<Slab> &planned);
+    void add_slabs(std::vector<Slab> &allocated, bool grown);
+    Slab *find_slab(uint32_t index);
+    void try_shrink();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool shutdown_ = false;
+    bool growing_ = false;
+    size_t slot_stride_ = 0;
+    std::vector<int> device_nodes_;
+    size_t next_device_ = 0;
+    uint32_t next_slot_ = 0;
+    std::vector<Slab> slabs_;
+    std::vector<uint32_t> free_slots_;
+    OutputPoolOptions options_;
+
+    size_t bytes_ = 0;
+    size_t high_water_bytes_ = 0;
+    size_t grow_events_ = 0;
+    size_t shrink_events_ = 0;
+    size_t budget_refusals_ = 0;
+    size_t grow_failures_ = 0;      // Growth steps whose slabs could not be allocated
+    size_t starvation_waits_ = 0;
+    std::chrono::steady_clock::time_point last_starvation_;
+};
+
+/**
+ * @brief Consumes an initialization argument if it is an output pool key.
+ *
+ * @return true if the key was consumed, false otherwise.
+ */
+bool output_pool_parse_arg(const char *key, const void *value, OutputPoolOptions &options);
+
+#endif // OUTPUT_POOL_H
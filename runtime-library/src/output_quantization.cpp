@@ -0,0 +1,104 @@
+#include "output_quantization.h"
+#include "string_list.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+static bool parse_scales(const std::string &text, std::vector<float> &scales) {
+    for (const auto &item : split_list(text, '/')) {
+        char *rest = nullptr;
+        float scale = strtof(item.c_str(), &rest);
+        if (rest == item.c_str() || *rest != '\0' || !(scale > 0.0f)) return false;
+        scales.push_back(scale);
+    }
+    return !scales.empty();
+}
+
+static bool parse_zero_points(const std::string &text, std::vector<int32_t> &zero_points) {
+    for (const auto &item : split_list(text, '/')) {
+        char *rest = nullptr;
+        long zero_point = strtol(item.c_str(), &rest, 10);
+        if (rest == item.c_str() || *rest != '\0') return false;
+        zero_points.push_back(static_cast<int32_t>(zero_point));
+    }
+    return !zero_points.empty();
+}
+
+bool output_quantization_parse(const char *text, std::map<std::string, OutputQuantization> &quantizations) {
+    quantizations.clear();
+    for (const auto &entry : split_list(text, ';')) {
+        if (entry.empty()) continue;
+        size_t equals = entry.rfind('=');
+        if (equals == std::string::npos || equals == 0) {
+            spdlog::error("Invalid output_quantization entry: '{}'", entry);
+            return false;
+        }
+
+        std::vector<std::string> fields = split_list(entry.substr(equals + 1), ',');
+        OutputQuantization quantization;
+        bool valid = fields.size() == 3 || fields.size() == 4;
+        if (valid) {
+            if (fields[0] == "int8") {
+                quantization.type = DATA_TYPE_INT8;
+            } else if (fields[0] == "uint8") {
+                quantization.type = DATA_TYPE_UINT8;
+            } else {
+                valid = false;
+            }
+        }
+        valid = valid && parse_scales(fields[1], quantization.scales) &&
+                parse_zero_points(fields[2], quantization.zero_points) &&
+                quantization.scales.size() == quantization.zero_points.size();
+        if (valid && fields.size() == 4) {
+            char *rest = nullptr;
+            quantization.axis = static_cast<int>(strtol(fields[3].c_str(), &rest, 10));
+            valid = rest != fields[3].c_str() && *rest == '\0';
+        }
+        if (!valid) {
+            spdlog::error("Invalid output_quantization entry: '{}'", entry);
+            return false;
+        }
+        quantizations[trim_whitespace(entry.substr(0, equals))] = quantization;
+    }
+    return true;
+}
+
+bool output_quantization_resolve(OutputQuantization &quantization, const std::vector<int64_t> &shape) {
+    if (quantization.scales.size() == 1) return true;
+
+    int rank = static_cast<int>(shape.size());
+    int axis = quantization.axis < 0 ? quantization.axis + rank : quantization.axis;
+    if (axis < 0 || axis >= rank || shape[axis] != static_cast<int64_t>(quantization.scales.size())) {
+        return false;
+    }
+    quantization.axis = axis;
+    return true;
+}
+
+void quantize_output(const float *src, void *dst, size_t count, const std::vector<int64_t> &shape,
+                     const OutputQuantization &quantization) {
+    size_t channels = quantization.scales.size();
+    if (channels == 1) {
+        convert_tensor_dtype(src, DATA_TYPE_FLOAT, dst, quantization.type, count, quantization.scales[0],
+                             quantization.zero_points[0]);
+        return;
+    }
+
+    // Channels repeat every channels * inner elements.
+    size_t inner = 1;
+    for (size_t d = quantization.axis + 1; d < shape.size(); d++) {
+        inner *= static_cast<size_t>(shape[d]);
+    }
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    for (size_t i = 0; i < count;) {
+        for (size_t c = 0; c < channels && i < count; c++) {
+            size_t n = std::min(inner, count - i);
+            convert_tensor_dtype(src + i, DATA_TYPE_FLOAT, out + i, quantization.type, n, quantization.scales[c],
+                                 quantization.zero_points[c]);
+            i += n;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef OUTPUT_QUANTIZATION_H
+#define OUTPUT_QUANTIZATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "tensors_struct.h"
+}
+
+/**
+ * @brief Quantization parameters of one output tensor, q = round(x / scale) + zero_point.
+ *
+ * A single scale and zero point apply to the whole tensor; several apply per channel along axis.
+ */
+struct OutputQuantization {
+    tensor_data_type type = DATA_TYPE_UNDEFINED;    // DATA_TYPE_INT8 or DATA_TYPE_UINT8
+    std::vector<float> scales;
+    std::vector<int32_t> zero_points;
+    int axis = -1;                                  // Channel axis, negative values count from the last axis
+};
+
+/**
+ * @brief Parses the "output_quantization" initialization argument.
+ *
+ * The value is a ';'-separated list of "name=type,scales,zero_points[,axis]" entries where type is
+ * int8 or uint8 and scales and zero_points are '/'-separated lists of equal length, for example
+ * "boxes=int8,0.0125,3;logits=uint8,0.1/0.2/0.4,0/0/0,1".
+ *
+ * @return false if the value is malformed.
+ */
+bool output_quantization_parse(const char *text, std::map<std::string, OutputQuantization> &quantizations);
+
+/**
+ * @brief Checks the parameters against the shape of the output and resolves a negative axis.
+ *
+ * @return false if the number of channels does not match the shape.
+ */
+bool output_quantization_resolve(OutputQuantization &quantization, const std::vector<int64_t> &shape);
+
+/**
+ * @brief Quantizes count floats of a tensor with the given shape into dst.
+ */
+void quantize_output(const float *src, void *dst, size_t count, const std::vector<int64_t> &shape,
+                     const OutputQuantization &quantization);
+
+#endif // OUTPUT_QUANTIZATION_H
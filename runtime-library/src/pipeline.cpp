@@ -0,0 +1,205 @@
+#include "pipeline.h"
+#include "thread_placement.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+
+#include <spdlog/spdlog.h>
+
+static double elapsed_us(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+Pipeline::~Pipeline() {
+    stop();
+}
+
+void Pipeline::add_stage(const std::string &name, StageFunction function) {
+    std::unique_ptr<Stage> stage(new Stage());
+    stage->name = name;
+    stage->function = function;
+    stages_.push_back(std::move(stage));
+}
+
+bool Pipeline::start(const PipelineOptions &options, Sink sink) {
+    if (options.threads == 0 || stages_.empty() || running()) {
+        return false;
+    }
+    for (auto &stage : stages_) {
+        auto it = options.workers.find(stage->name);
+        stage->workers = it != options.workers.end() ? std::max<size_t>(it->second, 1) : 1;
+    }
+    sink_ = sink;
+    capacity_ = std::max<size_t>(options.capacity, 1);
+    stop_ = false;
+    next_sequence_ = 0;
+    completed_ = 0;
+    latency_us_ = 0.0;
+    latency_us_max_ = 0.0;
+    started_ = Clock::now();
+    for (size_t i = 0; i < options.threads; i++) {
+        workers_.push_back(std::thread(&Pipeline::worker_loop, this));
+    }
+
+    std::ostringstream layout;
+    for (size_t s = 0; s < stages_.size(); s++) {
+        layout << (s > 0 ? " -> " : "") << stages_[s]->name << "x" << stages_[s]->workers;
+    }
+    spdlog::info("Pipeline {} started with {} threads, {} items per stage: {}", role_, workers_.size(), capacity_,
+                 layout.str());
+    return true;
+}
+
+void Pipeline::submit(void *item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Stage &first = *stages_.front();
+    space_cv_.wait(lock, [this, &first]() { return first.occupancy() < capacity_; });
+    Clock::time_point now = Clock::now();
+    first.queue.push_back(Task{next_sequence_++, item, now, now});
+    first.high_water = std::max(first.high_water, first.occupancy());
+    work_cv_.notify_one();
+}
+
+void Pipeline::stop() {
+    if (running()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            drained_cv_.wait(lock, [this]() { return completed_ == next_sequence_; });
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto &worker : workers_) {
+            if (worker.joinable()) worker.join();
+        }
+        workers_.clear();
+    }
+    stages_.clear();
+    sink_ = nullptr;
+}
+
+// The most downstream stage with a queued item, a free worker and room in the next stage, or -1.
+int Pipeline::runnable_stage() const {
+    for (size_t s = stages_.size(); s-- > 0;) {
+        const Stage &stage = *stages_[s];
+        if (stage.queue.empty() || stage.running >= stage.workers) continue;
+        if (s + 1 < stages_.size() && stages_[s + 1]->occupancy() >= capacity_) continue;
+        return static_cast<int>(s);
+    }
+    return -1;
+}
+
+// Moves the items finished by a stage to the next stage, or to the sink, in sequence order.
+void Pipeline::release(size_t s) {
+    Stage &stage = *stages_[s];
+    Clock::time_point now = Clock::now();
+    while (!stage.finished.empty() && stage.finished.begin()->first == stage.next_release) {
+        Task task = stage.finished.begin()->second;
+        stage.finished.erase(stage.finished.begin());
+        stage.next_release++;
+
+        if (s + 1 < stages_.size()) {
+            Stage &next = *stages_[s + 1];
+            next.reserved--;
+            task.queued = now;
+            next.queue.push_back(task);
+            next.high_water = std::max(next.high_water, next.occupancy());
+        } else {
+            double latency = elapsed_us(now - task.submitted);
+            latency_us_ += latency;
+            latency_us_max_ = std::max(latency_us_max_, latency);
+            completed_++;
+            sink_(task.item);
+        }
+    }
+    work_cv_.notify_all();
+    space_cv_.notify_all();
+    if (completed_ == next_sequence_) {
+        drained_cv_.notify_all();
+    }
+}
+
+void Pipeline::worker_loop() {
+    thread_placement_apply(role_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        int s = -1;
+        work_cv_.wait(lock, [this, &s]() {
+            s = runnable_stage();
+            return s >= 0 || stop_;
+        });
+        if (s < 0) break;
+
+        Stage &stage = *stages_[s];
+        Task task = stage.queue.front();
+        stage.queue.pop_front();
+        stage.running++;
+        if (static_cast<size_t>(s) + 1 < stages_.size()) {
+            Stage &next = *stages_[s + 1];
+            next.reserved++;
+            next.high_water = std::max(next.high_water, next.occupancy());
+        }
+        Clock::time_point start = Clock::now();
+        stage.wait_us += elapsed_us(start - task.queued);
+
+        lock.unlock();
+        stage.function(task.item);
+        Clock::time_point end = Clock::now();
+        lock.lock();
+
+        double service = elapsed_us(end - start);
+        stage.processed++;
+        stage.busy_us += service;
+        stage.service_us += service;
+        stage.service_us_max = std::max(stage.service_us_max, service);
+        stage.running--;
+        stage.finished[task.sequence] = task;
+        release(s);
+    }
+}
+
+std::string Pipeline::stats_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double wall_us = running() ? elapsed_us(Clock::now() - started_) : 0.0;
+    std::ostringstream out;
+    out << "{\"threads\":" << workers_.size() << ",\"capacity\":" << capacity_ << ",\"completed\":" << completed_
+        << ",\"in_flight\":" << next_sequence_ - completed_
+        << ",\"latency_us_avg\":" << static_cast<uint64_t>(completed_ > 0 ? latency_us_ / completed_ : 0.0)
+        << ",\"latency_us_max\":" << static_cast<uint64_t>(latency_us_max_) << ",\"stages\":[";
+    for (size_t s = 0; s < stages_.size(); s++) {
+        const Stage &stage = *stages_[s];
+        double utilization = wall_us > 0.0 ? stage.busy_us / (wall_us * stage.workers) : 0.0;
+        double processed = static_cast<double>(std::max<uint64_t>(stage.processed, 1));
+        out << (s > 0 ? "," : "") << "{\"name\":\"" << stage.name << "\",\"workers\":" << stage.workers
+            << ",\"processed\":" << stage.processed << ",\"utilization\":" << utilization
+            << ",\"occupancy\":" << stage.occupancy() << ",\"high_water\":" << stage.high_water
+            << ",\"wait_us_avg\":" << static_cast<uint64_t>(stage.wait_us / processed)
+            << ",\"service_us_avg\":" << static_cast<uint64_t>(stage.service_us / processed)
+            << ",\"service_us_max\":" << static_cast<uint64_t>(stage.service_us_max) << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+bool pipeline_parse_arg(const char *key, const void *value, PipelineOptions &options) {
+    if (strcmp(key, "pipeline_threads") == 0) {
+        options.threads = static_cast<size_t>(std::max(*static_cast<const int *>(value), 0));
+        return true;
+    }
+    if (strcmp(key, "pipeline_queue_depth") == 0) {
+        options.capacity = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    // pipeline_<stage>_workers
+    static const char prefix[] = "pipeline_";
+    static const char suffix[] = "_workers";
+    size_t length = strlen(key);
+    if (strncmp(key, prefix, sizeof(prefix) - 1) == 0 && length > sizeof(prefix) + sizeof(suffix) - 2 &&
+        strcmp(key + length - (sizeof(suffix) - 1), suffix) == 0) {
+        std::string stage(key + sizeof(prefix) - 1, length - (sizeof(prefix) - 1) - (sizeof(suffix) - 1));
+        options.workers[stage] = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    return false;
+}
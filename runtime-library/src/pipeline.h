@@ -0,0 +1,138 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PipelineOptions {
+    size_t threads = 0;                         // Shared worker threads, 0 disables the pipeline
+    size_t capacity = 16;                       // Items a stage may hold, queued, running or awaiting release
+    std::map<std::string, size_t> workers;      // Concurrent items per stage, 1 if not listed
+};
+
+/**
+ * @brief Runs items through ordered stages on a shared worker pool.
+ *
+ * Every stage may work on up to its worker count of items at once, so consecutive items overlap within a
+ * stage and across stages, but items leave each stage, and reach the sink, in submission order. A stage
+ * only starts an item when the next stage has room for it, so the number of items held by a stage never
+ * exceeds the capacity and submit() blocks while the first stage is full. Idle workers always pick the
+ * most downstream runnable stage, which drains finished work before admitting new items.
+ */
+class Pipeline {
+public:
+    using StageFunction = std::function<void(void *item)>;
+    using Sink = std::function<void(void *item)>;
+
+    /**
+     * @param role Thread placement role of the worker threads.
+     */
+    explicit Pipeline(const char *role = "pipeline") : role_(role) {}
+    ~Pipeline();
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    /**
+     * @brief Appends a stage. Stages are added before start().
+     */
+    void add_stage(const std::string &name, StageFunction function);
+
+    /**
+     * @brief Starts the worker threads, named after the pipeline's thread placement role.
+     *
+     * @param sink Receives every item in submission order once it left the last stage. It is called with
+     *             the pipeline lock held and must neither block nor call back into the pipeline.
+     * @return false if the options do not enable the pipeline or there is no stage.
+     */
+    bool start(const PipelineOptions &options, Sink sink);
+
+    /**
+     * @brief Hands an item to the first stage, blocking while the stage is full.
+     */
+    void submit(void *item);
+
+    /**
+     * @brief Waits until every submitted item reached the sink, joins the workers and removes the stages.
+     */
+    void stop();
+
+    bool running() const { return !workers_.empty(); }
+
+    /**
+     * @return The per-stage utilization, queue and latency statistics as a JSON object.
+     */
+    std::string stats_json();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        uint64_t sequence;
+        void *item;
+        Clock::time_point submitted;
+        Clock::time_point queued;
+    };
+
+    struct Stage {
+        std::string name;
+        StageFunction function;
+        size_t workers = 1;
+
+        std::deque<Task> queue;
+        std::map<uint64_t, Task> finished;  // Done, waiting for the items before them
+        size_t running = 0;
+        size_t reserved = 0;                // Started upstream, bound for this stage
+        uint64_t next_release = 0;
+
+        uint64_t processed = 0;
+        size_t high_water = 0;
+        double busy_us = 0.0;
+        double wait_us = 0.0;
+        double service_us = 0.0;
+        double service_us_max = 0.0;
+
+        size_t occupancy() const { return queue.size() + finished.size() + running + reserved; }
+    };
+
+    void worker_loop();
+    int runnable_stage() const;
+    void release(size_t stage);
+
+    const char *role_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::vector<std::thread> workers_;
+    Sink sink_;
+    size_t capacity_ = 0;
+    Clock::time_point started_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable space_cv_;
+    std::condition_variable drained_cv_;
+    bool stop_ = false;
+    uint64_t next_sequence_ = 0;
+    uint64_t completed_ = 0;
+    double latency_us_ = 0.0;
+    double latency_us_max_ = 0.0;
+};
+
+/**
+ * @brief Consumes an initialization argument if it is a pipeline key.
+ *
+ * @return true if the key was consumed, false otherwise.
+ */
+bool pipeline_parse_arg(const char *key, const void *value, PipelineOptions &options);
+
+#endif // PIPELINE_H
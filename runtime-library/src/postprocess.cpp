@@ -0,0 +1,198 @@
+#include "postprocess.h"
+#include "classification_postprocess.h"
+#include "segmentation_postprocess.h"
+#include "yolo_postprocess.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POSTPROCESS_SSE2 1
+#endif
+
+static bool parse_float(const char *key, const void *value, float &result) {
+    const char *text = static_cast<const char *>(value);
+    char *rest = nullptr;
+    float parsed = strtof(text, &rest);
+    if (rest == text || *rest != '\0') {
+        spdlog::warn("Ignoring invalid value for {}: '{}'", key, text);
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+bool postprocess_parse_arg(const char *key, const void *value, PostprocessOptions &options) {
+    if (strcmp(key, "postprocess") == 0) {
+        options.stage = static_cast<const char *>(value);
+        return true;
+    }
+    if (strcmp(key, "postprocess_output") == 0) {
+        options.output = static_cast<const char *>(value);
+        return true;
+    }
+    if (strcmp(key, "postprocess_score_threshold") == 0) {
+        parse_float(key, value, options.score_threshold);
+        return true;
+    }
+    if (strcmp(key, "postprocess_iou_threshold") == 0) {
+        parse_float(key, value, options.iou_threshold);
+        return true;
+    }
+    if (strcmp(key, "postprocess_max_detections") == 0) {
+        options.max_detections = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    if (strcmp(key, "postprocess_max_candidates") == 0) {
+        options.max_candidates = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    if (strcmp(key, "postprocess_sigmoid") == 0) {
+        options.sigmoid = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    if (strcmp(key, "postprocess_top_k") == 0) {
+        options.top_k = static_cast<size_t>(std::max(*static_cast<const int *>(value), 1));
+        return true;
+    }
+    if (strcmp(key, "postprocess_softmax") == 0) {
+        options.softmax = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    if (strcmp(key, "postprocess_confidence") == 0) {
+        options.confidence = *static_cast<const int *>(value) != 0;
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<Postprocessor> postprocess_create(const PostprocessOptions &options) {
+    if (options.stage.empty()) {
+        return nullptr;
+    }
+    if (options.stage == "yolov5") {
+        return std::unique_ptr<Postprocessor>(new YoloPostprocessor(options, YoloFormat::V5));
+    }
+    if (options.stage == "yolov8") {
+        return std::unique_ptr<Postprocessor>(new YoloPostprocessor(options, YoloFormat::V8));
+    }
+    if (options.stage == "classification") {
+        return std::unique_ptr<Postprocessor>(new ClassificationPostprocessor(options));
+    }
+    if (options.stage == "segmentation") {
+        return std::unique_ptr<Postprocessor>(new SegmentationPostprocessor(options));
+    }
+    spdlog::error("Unknown postprocess stage: {}", options.stage);
+    return nullptr;
+}
+
+int postprocess_find_output(const std::vector<PostprocessTensor> &outputs, const PostprocessOptions &options) {
+    if (options.output.empty()) {
+        return outputs.empty() ? -1 : 0;
+    }
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (outputs[i].name == options.output) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+#if defined(POSTPROCESS_SSE2)
+// exp(x) for four lanes: x = n * ln(2) + r, exp(r) from a degree-5 polynomial, 2^n through the exponent
+// bits. The relative error is within 2 ulp over the clamped range, inputs below it flush to zero.
+static inline __m128 exp_ps(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-88.3762626647949f)), _mm_set1_ps(88.3762626647949f));
+
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    fx = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, fx), _mm_set1_ps(1.0f)));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.0f));
+
+    __m128i n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+#endif
+
+float postprocess_exp_sum(const float *src, size_t count, float shift) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(POSTPROCESS_SSE2)
+    const __m128 shift4 = _mm_set1_ps(shift);
+    __m128 sum4 = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        sum4 = _mm_add_ps(sum4, exp_ps(_mm_sub_ps(_mm_loadu_ps(src + i), shift4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum4);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < count; i++) {
+        sum += expf(src[i] - shift);
+    }
+    return sum;
+}
+
+void postprocess_exp_accumulate(const float *src, const float *shift, float *sum, size_t count) {
+    size_t i = 0;
+#if defined(POSTPROCESS_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 e = exp_ps(_mm_sub_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(shift + i)));
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), e));
+    }
+#endif
+    for (; i < count; i++) {
+        sum[i] += expf(src[i] - shift[i]);
+    }
+}
+
+tensors_struct *postprocess_allocate_result(const std::vector<PostprocessResultTensor> &tensors) {
+    int count = static_cast<int>(tensors.size());
+    tensors_struct *result = allocate_tensors_struct(count);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    for (int i = 0; i < count; i++) {
+        result->names[i] = nullptr;
+        result->shapes[i] = nullptr;
+        result->data[i] = nullptr;
+        result->data_types[i] = tensors[i].type;
+        result->ranks[i] = tensors[i].shape.size();
+    }
+
+    for (int i = 0; i < count; i++) {
+        const std::vector<size_t> &shape = tensors[i].shape;
+        size_t bytes = get_data_type_byte_size(tensors[i].type);
+        for (size_t dim : shape) {
+            bytes *= dim;
+        }
+        result->names[i] = tensors_strdup(tensors[i].name);
+        result->shapes[i] = static_cast<size_t *>(tensors_malloc(std::max<size_t>(shape.size(), 1) * sizeof(size_t)));
+        // An empty result still gets a valid data pointer.
+        result->data[i] = tensors_malloc(std::max<size_t>(bytes, 1));
+        if (result->names[i] == nullptr || result->shapes[i] == nullptr || result->data[i] == nullptr) {
+            deep_free_tensors_struct(result);
+            return nullptr;
+        }
+        std::copy(shape.begin(), shape.end(), result->shapes[i]);
+    }
+    return result;
+}
+
+tensors_struct *postprocess_allocate_result(const char *name, tensor_data_type type,
+                                            const std::vector<size_t> &shape) {
+    return postprocess_allocate_result(std::vector<PostprocessResultTensor>{{name, type, shape}});
+}
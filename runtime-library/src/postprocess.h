@@ -0,0 +1,101 @@
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "tensors_struct.h"
+}
+
+/**
+ * @brief An output tensor as seen by a postprocess stage. data is null while the stage is initialized.
+ */
+struct PostprocessTensor {
+    std::string name;
+    std::vector<int64_t> shape;
+    tensor_data_type type = DATA_TYPE_UNDEFINED;
+    const void *data = nullptr;
+};
+
+struct PostprocessOptions {
+    std::string stage;                  // "yolov5", "yolov8", "classification", "segmentation" or empty
+    std::string output;                 // Output read by the stage, the first output if empty
+    float score_threshold = 0.25f;
+    float iou_threshold = 0.45f;
+    size_t max_detections = 300;
+    size_t max_candidates = 4096;       // Candidates kept for NMS, by descending score
+    bool sigmoid = false;               // Scores are logits
+    size_t top_k = 5;                   // Classes returned by the classification stage
+    bool softmax = true;                // Classification scores are probabilities rather than logits
+    bool confidence = false;            // The segmentation stage also returns per-pixel confidences
+};
+
+/**
+ * @brief A stage that turns the raw model outputs into a compact result, run on the wait thread.
+ */
+class Postprocessor {
+public:
+    virtual ~Postprocessor() {}
+
+    /**
+     * @brief Checks the model outputs against the stage.
+     *
+     * @return false if the model outputs do not fit the stage.
+     */
+    virtual bool init(const std::vector<PostprocessTensor> &outputs) = 0;
+
+    /**
+     * @return The result allocated with the tensors allocator, or nullptr on failure.
+     */
+    virtual tensors_struct *run(const std::vector<PostprocessTensor> &outputs) = 0;
+};
+
+/**
+ * @brief Consumes an initialization argument if it is a postprocess key.
+ *
+ * @return true if the key was consumed, false otherwise.
+ */
+bool postprocess_parse_arg(const char *key, const void *value, PostprocessOptions &options);
+
+/**
+ * @return The stage selected by the options, nullptr if none is selected or the stage is unknown.
+ */
+std::unique_ptr<Postprocessor> postprocess_create(const PostprocessOptions &options);
+
+/**
+ * @return The index of the output named by the options, or -1 if it does not exist.
+ */
+int postprocess_find_output(const std::vector<PostprocessTensor> &outputs, const PostprocessOptions &options);
+
+/**
+ * @brief Computes the sum of exp(src[i] - shift), vectorized where the target allows it.
+ */
+float postprocess_exp_sum(const float *src, size_t count, float shift);
+
+/**
+ * @brief Adds exp(src[i] - shift[i]) to sum[i], vectorized where the target allows it.
+ */
+void postprocess_exp_accumulate(const float *src, const float *shift, float *sum, size_t count);
+
+struct PostprocessResultTensor {
+    const char *name;
+    tensor_data_type type;
+    std::vector<size_t> shape;
+};
+
+/**
+ * @brief Allocates a result holding the given tensors, with uninitialized data.
+ */
+tensors_struct *postprocess_allocate_result(const std::vector<PostprocessResultTensor> &tensors);
+
+/**
+ * @brief Allocates a single-tensor result with the given name, type and shape.
+ */
+tensors_struct *postprocess_allocate_result(const char *name, tensor_data_type type,
+                                            const std::vector<size_t> &shape);
+
+#endif // POSTPROCESS_H
@@ -1,10 +1,26 @@
 #include "runtime_core.h"
+#include "copy_engine.h"
+#include "fd_input.h"
+#include "numa_placement.h"
+#include "output_layout.h"
+#include "output_notifier.h"
+#include "output_pool.h"
+#include "output_quantization.h"
+#include "pipeline.h"
+#include "postprocess.h"
+#include "stream_copy.h"
+#include "stream_scheduler.h"
+#include "string_list.h"
+#include "thread_placement.h"
 
 extern "C" {
 #include "tensors_struct.h"
 }
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <new>
 #include <vector>
 #include <queue>
 #include <mutex>
@@ -14,97 +30,245 @@ extern "C" {
 #include <stdio.h>
 #include <thread>
 #include <fstream>
+#include <sstream>
 
 #include <dxrt/dxrt_api.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
 struct JobData {
-    int job_id;
-    void *outputs_ptr; 
-    tensors_struct *input_tensors;
+    int job_id = -1;
+    void *outputs_ptr = nullptr; 
+    tensors_struct *input_tensors = nullptr;
+    FdInputMapping fd_input;
+    input_release_callback release_input = nullptr;
+    void *release_input_ctx = nullptr;
+    const void *input_ptr = nullptr;    // Input data as handed over by the caller
+    void *staging_ptr = nullptr;        // Runtime-owned copy of the input in staging mode
+    std::shared_ptr<const std::vector<size_t>> outputs; // Indices of the outputs returned to the caller
     std::vector<std::shared_ptr<dxrt::Tensor>> dxrt_outputs;
+    tensors_struct *result = nullptr;   // Outputs returned to the caller, once materialized
+    bool failed = false;                // The outputs could not be produced
+    uint64_t tag = 0;                   // Caller's correlation tag, handed back to the output callback
+    runtime_stream *stream = nullptr;   // Stream the outputs are returned to, if any
+};
+
+// How an output is turned from its bytes in the device buffer into the tensor returned to the caller.
+struct HostOutput {
+    uint64_t size = 0;                              // Bytes returned to the caller
+    size_t elements = 0;                            // Elements returned to the caller
+    tensor_data_type type = DATA_TYPE_UNDEFINED;    // Type returned to the caller
+    OutputQuantization quantization;                // Type is undefined if not quantized
+    bool unpack = false;                            // Padding is stripped or the layout converted
+    OutputLayout layout;
 };
 
 static std::shared_ptr<spdlog::logger> logger;
 
-static dxrt::InferenceEngine *inference_engine = nullptr;
-static std::vector<uint64_t> OutputTensorSizes;
+static tensor_data_type mapDataTypeToTensorDataType(dxrt::DataType dtype);
+static void release_job_input(JobData &job_data);
+
+/**
+ * @brief A source of inputs admitted to the device in turn with the other streams of its context.
+ *
+ * Its outputs wait in their own queue, so a stream that falls behind does not hold back the others.
+ */
+struct runtime_stream {
+    runtime_context *context = nullptr;
+    StreamScheduler::Stream *admission = nullptr;
+    std::queue<JobData> outputs;
+    std::mutex outputs_mutex;
+    std::condition_variable outputs_cv;
+    // Guarded by outputs_mutex: set once the stream is being destroyed, and the number of threads in
+    // stream_receive, which the stream must not be freed under.
+    bool closing = false;
+    size_t receivers = 0;
+};
+
+/**
+ * @brief One loaded model with its own engine, buffer pools, queues and threads.
+ *
+ * The OAAX functions operate on a default context; further contexts are created through the
+ * runtime_context_* functions. Process-wide settings (logging, thread and NUMA placement, the
+ * fd input cache and the tensors allocator) are shared by all contexts.
+ */
+struct runtime_context {
+    int parse_args(int length, const char **keys, const void **values);
+    int load_model(const char *file_path);
+    int send_tensors(tensors_struct *input_tensors, uint64_t tag, const char *caller);
+    int send_fd(int fd, size_t offset, size_t size, input_release_callback release, void *user_ctx);
+    int infer(const tensors_struct *input_tensors, tensors_struct **output_tensors);
+    int receive(tensors_struct **output_tensors, bool wait, const char *caller);
+    int output_fd();
+    int output_quantization(const char *output_name, output_quantization_params *params);
+    int select_outputs(const char *output_names);
+    int set_output_callback(output_delivery_callback callback, void *user_ctx);
+    int set_output_stage(output_stage_callback callback, void *user_ctx);
+    runtime_stream *create_stream(int max_in_flight, int weight);
+    int destroy_stream(runtime_stream *stream);
+    int schedule_job(runtime_stream *stream, tensors_struct *input_tensors, uint64_t tag, int priority,
+                     uint64_t deadline_us, const char *caller);
+    int stream_receive(runtime_stream *stream, tensors_struct **output_tensors, bool wait, const char *caller);
+    void wait_for_receivers(runtime_stream *stream);
+    void destroy();
+    const char *stats();
 
-static size_t OUTPUTS_POOL_CAPACITY = 0;
-static size_t NumDevice = 0;
+private:
+    tensors_struct *create_output_tensors_struct(const std::vector<size_t> &selection);
+    tensors_struct *copy_dxrt_outputs_to_output_tensors_struct(const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs, const std::vector<size_t> &selection, tensors_struct *output_tensors);
+    void copy_output_data(dxrt::Tensor &output, size_t index, const std::vector<int64_t> &shape, void *dst,
+                          std::vector<CopyTask> &copy_tasks);
+    std::vector<int64_t> host_output_shape(dxrt::Tensor &output, size_t index);
+    std::shared_ptr<const std::vector<size_t>> parse_output_selection(const char *names);
+    bool init_host_outputs();
+    bool init_postprocessor();
+    void abandon_job(JobData &job_data);
+    bool check_output_tensors(const tensors_struct *output_tensors, const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs,
+                              const std::vector<size_t> &selection);
+    int submit_job(JobData &job_data, void *input_ptr, const char *caller);
+    int run_job(JobData &job_data, void *input_ptr, void *outputs_ptr, const char *caller);
+    void stage_job(JobData &job_data);
+    int dispatch_job(JobData &job_data, const char *caller);
+    void postprocess_job(JobData &job_data);
+    void materialize_job(JobData &job_data);
+    void output_stage_job(JobData &job_data);
+    void deliver_job(JobData &job_data);
+    bool start_pipeline();
+    bool start_delivery();
+    void push_output(JobData &job_data);
+    int pop_output(JobData &job_data, bool wait);
+    int finish_output(JobData &job_data, tensors_struct **output_tensors);
+    void staging_loop();
+    void wait_loop();
+    void admission_loop();
+    bool start_admission(const char *caller);
 
-static std::queue<void*> outputs_ptr_pool;
-static std::mutex outputs_pool_mutex;
-static std::condition_variable outputs_pool_cv;
+    dxrt::InferenceEngine *inference_engine = nullptr;
+    std::vector<uint64_t> OutputTensorSizes;
+    std::vector<std::string> OutputTensorNames;
+    std::vector<HostOutput> HostOutputs;
+    std::string output_quantization_arg;
+    tensor_data_type output_float_type = DATA_TYPE_FLOAT;  // Type float outputs are returned in
+    LayoutConversion output_layout_conversion = LayoutConversion::NONE;
 
-static std::queue<JobData> job_data_queue;
-static std::mutex job_data_queue_mutex;
-static std::condition_variable job_data_queue_cv;
+    std::string output_names_arg;
+    std::shared_ptr<const std::vector<size_t>> output_selection;
+    std::mutex output_selection_mutex;
 
-static std::queue<JobData> output_queue;
-static std::mutex output_queue_mutex;
-static std::condition_variable output_queue_cv;
+    PostprocessOptions postprocess_options;
+    std::unique_ptr<Postprocessor> postprocessor;
+    std::vector<PostprocessTensor> PostprocessInputs;
 
-static std::atomic<bool> stop_wait_thread{false};
-static std::atomic<bool> wait_thread_started{false};
-static std::thread wait_thread;
+    Pipeline pipeline{"pipeline"};
+    PipelineOptions pipeline_options;
+    output_stage_callback output_stage = nullptr;
+    void *output_stage_ctx = nullptr;
 
-static tensors_struct *create_output_tensors_struct();
-static tensors_struct *copy_dxrt_outputs_to_output_tensors_struct(const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs, tensors_struct *output_tensors);
-static tensor_data_type mapDataTypeToTensorDataType(dxrt::DataType dtype);
-static void wait_loop();
+    Pipeline delivery{"delivery"};
+    output_delivery_callback output_delivery = nullptr;
+    void *output_delivery_ctx = nullptr;
+    size_t output_delivery_threads = 1;
+    size_t output_delivery_queue_depth = 16;
+
+    size_t OUTPUTS_POOL_CAPACITY = 0;
+    size_t NumDevice = 0;
+
+    OutputPool outputs_pool;
+    OutputPoolOptions outputs_pool_options;
+
+    std::queue<JobData> job_data_queue;
+    std::mutex job_data_queue_mutex;
+    std::condition_variable job_data_queue_cv;
+
+    std::queue<JobData> output_queue;
+    std::mutex output_queue_mutex;
+    std::condition_variable output_queue_cv;
+    OutputNotifier output_notifier;    // Readable while output_queue is not empty
+
+    std::string stats_buffer;
+    std::mutex stats_mutex;
+
+    CopyEngine copy_engine;
+    CopyEngineOptions copy_engine_options;
+
+    bool input_staging_enabled = false;
+    size_t input_staging_buffers = 0;
+    size_t InputSize = 0;
+    OutputPool staging_pool;
+    std::queue<JobData> staging_queue;
+    std::mutex staging_queue_mutex;
+    std::condition_variable staging_queue_cv;
+    std::atomic<bool> stop_staging_thread{false};
+    std::atomic<bool> staging_thread_started{false};
+    std::thread staging_thread;
+
+    std::atomic<bool> stop_wait_thread{false};
+    std::atomic<bool> wait_thread_started{false};
+    std::thread wait_thread;
 
-static tensors_struct *create_output_tensors_struct() {
-    int num_tensors = OutputTensorSizes.size();
+    StreamScheduler admission;
+    std::vector<runtime_stream *> streams;
+    std::mutex streams_mutex;
+    std::condition_variable streams_cv;
+    size_t stream_destructions = 0;            // runtime_stream_destruction calls draining, guarded by streams_mutex
+    StreamScheduler::Stream *scheduled_queue = nullptr;  // Scheduled inputs without a stream
+    bool admission_thread_started = false;     // Guarded by streams_mutex
+    std::thread admission_thread;
+};
+
+// The context behind the OAAX functions.
+static runtime_context default_context;
+
+tensors_struct *runtime_context::create_output_tensors_struct(const std::vector<size_t> &selection) {
+    int num_tensors = selection.size();
     if (num_tensors == 0) {
         return nullptr;
     }
     
-    tensors_struct *tensors = (tensors_struct *)malloc(sizeof(tensors_struct));
+    tensors_struct *tensors = (tensors_struct *)tensors_malloc(sizeof(tensors_struct));
     if (tensors == nullptr) {
         return nullptr;
     }
     
     tensors->num_tensors = num_tensors;
     
-    tensors->names = (char **)malloc(num_tensors * sizeof(char *));
+    tensors->names = (char **)tensors_malloc(num_tensors * sizeof(char *));
     if (tensors->names == nullptr) {
-        free(tensors);
+        tensors_free(tensors);
         return nullptr;
     }
     
-    tensors->data_types = (tensor_data_type *)malloc(num_tensors * sizeof(tensor_data_type));
+    tensors->data_types = (tensor_data_type *)tensors_malloc(num_tensors * sizeof(tensor_data_type));
     if (tensors->data_types == nullptr) {
-        free(tensors->names);
-        free(tensors);
+        tensors_free(tensors->names);
+        tensors_free(tensors);
         return nullptr;
     }
     
-    tensors->ranks = (size_t *)malloc(num_tensors * sizeof(size_t));
+    tensors->ranks = (size_t *)tensors_malloc(num_tensors * sizeof(size_t));
     if (tensors->ranks == nullptr) {
-        free(tensors->data_types);
-        free(tensors->names);
-        free(tensors);
+        tensors_free(tensors->data_types);
+        tensors_free(tensors->names);
+        tensors_free(tensors);
         return nullptr;
     }
     
-    tensors->shapes = (size_t **)malloc(num_tensors * sizeof(size_t *));
+    tensors->shapes = (size_t **)tensors_malloc(num_tensors * sizeof(size_t *));
     if (tensors->shapes == nullptr) {
-        free(tensors->ranks);
-        free(tensors->data_types);
-        free(tensors->names);
-        free(tensors);
+        tensors_free(tensors->ranks);
+        tensors_free(tensors->data_types);
+        tensors_free(tensors->names);
+        tensors_free(tensors);
         return nullptr;
     }
     
-    tensors->data = (void **)malloc(num_tensors * sizeof(void *));
+    tensors->data = (void **)tensors_malloc(num_tensors * sizeof(void *));
     if (tensors->data == nullptr) {
-        free(tensors->shapes);
-        free(tensors->ranks);
-        free(tensors->data_types);
-        free(tensors->names);
-        free(tensors);
+        tensors_free(tensors->shapes);
+        tensors_free(tensors->ranks);
+        tensors_free(tensors->data_types);
+        tensors_free(tensors->names);
+        tensors_free(tensors);
         return nullptr;
     }
         
@@ -113,7 +277,7 @@ static tensors_struct *create_output_tensors_struct() {
         tensors->data_types[i] = DATA_TYPE_UNDEFINED;
         tensors->ranks[i] = 0;
         tensors->shapes[i] = nullptr;
-        tensors->data[i] = malloc(OutputTensorSizes[i]);
+        tensors->data[i] = tensors_malloc(HostOutputs[selection[i]].size);
         if (tensors->data[i] == nullptr) {
             deep_free_tensors_struct(tensors);
             return nullptr;
@@ -123,26 +287,26 @@ static tensors_struct *create_output_tensors_struct() {
     return tensors;
 }
 
-static tensors_struct *copy_dxrt_outputs_to_output_tensors_struct(const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs, tensors_struct *output_tensors) {
-    size_t num_output_tensors = outputs.size();
+tensors_struct *runtime_context::copy_dxrt_outputs_to_output_tensors_struct(const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs, const std::vector<size_t> &selection, tensors_struct *output_tensors) {
+    size_t num_output_tensors = selection.size();
+    std::vector<CopyTask> copy_tasks;
     if (output_tensors == nullptr) {
         return nullptr;
     }
-    if (num_output_tensors == 0 || output_tensors->num_tensors != num_output_tensors) {
+    if (outputs.size() != OutputTensorSizes.size() || output_tensors->num_tensors != num_output_tensors) {
         spdlog::error("Output tensor size mismatch: dxrt_outputs={}, output_tensors_struct={}",
-                      num_output_tensors, output_tensors->num_tensors);
+                      outputs.size(), output_tensors->num_tensors);
         return nullptr;
     }
     
     for (size_t i = 0; i < num_output_tensors; i++) {
-        const auto& output = outputs[i];
+        const auto& output = outputs[selection[i]];
+        const HostOutput &host = HostOutputs[selection[i]];
         
         auto name = output->name();
-        auto shape = output->shape();
-        auto dtype = output->type();
-        auto data = output->data();
+        auto shape = host_output_shape(*output, selection[i]);
         
-        output_tensors->names[i] = strdup(name.c_str());
+        output_tensors->names[i] = tensors_strdup(name.c_str());
         if (!output_tensors->names[i]) {
             spdlog::error("Failed to allocate name for tensor {}", i);
             deep_free_tensors_struct(output_tensors);
@@ -150,7 +314,7 @@ static tensors_struct *copy_dxrt_outputs_to_output_tensors_struct(const std::vec
         }
         
         output_tensors->ranks[i] = shape.size();
-        output_tensors->shapes[i] = (size_t *)malloc(shape.size() * sizeof(size_t));
+        output_tensors->shapes[i] = (size_t *)tensors_malloc(shape.size() * sizeof(size_t));
         if (!output_tensors->shapes[i]) {
             spdlog::error("Failed to allocate shape for tensor {}", i);
             deep_free_tensors_struct(output_tensors);
@@ -161,13 +325,180 @@ static tensors_struct *copy_dxrt_outputs_to_output_tensors_struct(const std::vec
             output_tensors->shapes[i][j] = shape[j];
         }
 
-        output_tensors->data_types[i] = mapDataTypeToTensorDataType(dtype);
-        
-        memcpy(output_tensors->data[i], data, OutputTensorSizes[i]);
+        output_tensors->data_types[i] = host.type;
+        copy_output_data(*output, selection[i], shape, output_tensors->data[i], copy_tasks);
     }
+
+    copy_engine.copy(copy_tasks);
     return output_tensors;
 }
 
+// Writes output index from the device buffer to dst in the returned type and layout. Plain copies are
+// appended to copy_tasks for the copy engine, everything else is done in place.
+void runtime_context::copy_output_data(dxrt::Tensor &output, size_t index, const std::vector<int64_t> &shape,
+                                       void *dst, std::vector<CopyTask> &copy_tasks) {
+    const HostOutput &host = HostOutputs[index];
+    const void *data = output.data();
+
+    bool convert = output.type() == dxrt::FLOAT && host.type != DATA_TYPE_FLOAT;
+    if (!convert && !host.unpack) {
+        copy_tasks.push_back(CopyTask{dst, data, OutputTensorSizes[index]});
+        return;
+    }
+    if (!convert) {
+        output_layout_unpack(data, dst, host.layout);
+        return;
+    }
+
+    // Conversions apply to the returned layout, e.g. the quantization axis indexes the returned shape.
+    const void *src = data;
+    if (host.unpack) {
+        static thread_local std::vector<float> unpacked;
+        unpacked.resize(host.elements);
+        output_layout_unpack(data, unpacked.data(), host.layout);
+        src = unpacked.data();
+    }
+    if (host.quantization.type != DATA_TYPE_UNDEFINED) {
+        quantize_output(static_cast<const float *>(src), dst, host.elements, shape, host.quantization);
+    } else {
+        convert_tensor_dtype(src, DATA_TYPE_FLOAT, dst, host.type, host.elements, 1.0f, 0);
+    }
+}
+
+// The shape an output is returned with.
+std::vector<int64_t> runtime_context::host_output_shape(dxrt::Tensor &output, size_t index) {
+    std::vector<int64_t> shape = output.shape();
+    if (HostOutputs[index].unpack) {
+        output_layout_shape(HostOutputs[index].layout, shape);
+    }
+    return shape;
+}
+
+// Resolves a comma-separated list of output names to output indices. NULL or an empty list selects
+// every output.
+std::shared_ptr<const std::vector<size_t>> runtime_context::parse_output_selection(const char *names) {
+    std::shared_ptr<std::vector<size_t>> selection = std::make_shared<std::vector<size_t>>();
+    if (names == nullptr || names[0] == '\0') {
+        for (size_t i = 0; i < OutputTensorNames.size(); i++) {
+            selection->push_back(i);
+        }
+        return selection;
+    }
+
+    std::vector<bool> selected(OutputTensorNames.size(), false);
+    for (const auto &name : split_list(names, ',')) {
+        auto it = std::find(OutputTensorNames.begin(), OutputTensorNames.end(), name);
+        if (it == OutputTensorNames.end()) {
+            spdlog::error("Unknown output tensor: {}", name);
+            return nullptr;
+        }
+        selected[it - OutputTensorNames.begin()] = true;
+    }
+    // Outputs keep the model order whatever the order of the list.
+    for (size_t i = 0; i < selected.size(); i++) {
+        if (selected[i]) selection->push_back(i);
+    }
+    if (selection->empty()) {
+        spdlog::error("No output tensor selected");
+        return nullptr;
+    }
+    return selection;
+}
+
+// Resolves how each output is returned: padded rows are stripped and rank-4 layouts converted,
+// float outputs with quantization parameters are quantized on the host, outputs that dxrt already returns
+// in the quantized type are copied unchanged with those parameters, and the other float outputs are converted
+// to output_float_type. Everything is done in the pass that copies the output out of the device buffer.
+bool runtime_context::init_host_outputs() {
+    std::map<std::string, OutputQuantization> quantizations;
+    if (!output_quantization_parse(output_quantization_arg.c_str(), quantizations)) {
+        return false;
+    }
+
+    dxrt::Tensors outputs = inference_engine->GetOutputs();
+    HostOutputs.assign(outputs.size(), HostOutput());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        HostOutput &host = HostOutputs[i];
+        dxrt::DataType dtype = outputs[i].type();
+        size_t elem_size = outputs[i].elem_size();
+        std::vector<int64_t> shape = outputs[i].shape();
+        tensor_data_type device_type = mapDataTypeToTensorDataType(dtype);
+
+        host.type = device_type;
+        host.unpack = output_layout_init(shape, elem_size, OutputTensorSizes[i], output_layout_conversion, host.layout);
+        if (host.unpack) {
+            output_layout_shape(host.layout, shape);
+            host.elements = host.layout.rows * host.layout.row_elems;
+            spdlog::info("Unpacking output {}: rows of {} of {} elements{}", outputs[i].name(), host.layout.row_elems,
+                         host.layout.row_stride,
+                         host.layout.conversion == LayoutConversion::NONE ? "" : ", layout converted");
+        } else {
+            host.elements = elem_size > 0 ? OutputTensorSizes[i] / elem_size : 0;
+        }
+
+        auto it = quantizations.find(outputs[i].name());
+        if (it != quantizations.end()) {
+            OutputQuantization quantization = it->second;
+            quantizations.erase(it);
+            if (!output_quantization_resolve(quantization, shape)) {
+                spdlog::error("Quantization channels of output {} do not match its shape", outputs[i].name());
+                return false;
+            }
+            if (dtype != dxrt::FLOAT && device_type != quantization.type) {
+                spdlog::error("Output {} cannot be returned quantized to {}", outputs[i].name(),
+                              quantization.type == DATA_TYPE_INT8 ? "int8" : "uint8");
+                return false;
+            }
+            spdlog::info("Returning output {} quantized with {} scale(s)", outputs[i].name(), quantization.scales.size());
+            host.quantization = quantization;
+            host.type = quantization.type;
+        } else if (dtype == dxrt::FLOAT) {
+            host.type = output_float_type;
+        }
+
+        if (host.type == device_type && !host.unpack) {
+            host.size = OutputTensorSizes[i];
+        } else {
+            host.size = host.elements * (host.type == device_type ? elem_size : get_data_type_byte_size(host.type));
+        }
+    }
+    for (const auto &unknown : quantizations) {
+        spdlog::error("Unknown output tensor in output_quantization: {}", unknown.first);
+        return false;
+    }
+    return true;
+}
+
+// Creates the postprocess stage selected by the init args. The stage reads the device buffers directly,
+// so it only accepts outputs without row padding.
+bool runtime_context::init_postprocessor() {
+    if (postprocess_options.stage.empty()) {
+        return true;
+    }
+    postprocessor = postprocess_create(postprocess_options);
+    if (!postprocessor) {
+        return false;
+    }
+
+    dxrt::Tensors outputs = inference_engine->GetOutputs();
+    PostprocessInputs.assign(outputs.size(), PostprocessTensor());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        PostprocessInputs[i].name = outputs[i].name();
+        PostprocessInputs[i].shape = outputs[i].shape();
+        const OutputLayout &layout = HostOutputs[i].layout;
+        bool padded = HostOutputs[i].unpack && layout.row_stride != layout.row_elems;
+        // Padded outputs are hidden from the stage by leaving their type undefined.
+        PostprocessInputs[i].type = padded ? DATA_TYPE_UNDEFINED : mapDataTypeToTensorDataType(outputs[i].type());
+    }
+    if (!postprocessor->init(PostprocessInputs)) {
+        spdlog::error("The model outputs do not fit the {} postprocess stage", postprocess_options.stage);
+        postprocessor.reset();
+        return false;
+    }
+    spdlog::info("Postprocessing outputs with the {} stage", postprocess_options.stage);
+    return true;
+}
+
 static tensor_data_type mapDataTypeToTensorDataType(dxrt::DataType dtype) {
     switch (dtype) {
     case dxrt::UINT8:
@@ -207,22 +538,99 @@ int runtime_initialization() {
 }
 
 int runtime_initialization_with_args(int length, const char **keys, const void **values) {
-    (void)values;
-    
     int ret = runtime_initialization();
     if (ret != 0) {
         return ret;
     }
 
     spdlog::info("Runtime initialized with arguments");
+    return default_context.parse_args(length, keys, values);
+}
+
+int runtime_context::parse_args(int length, const char **keys, const void **values) {
     for (int i = 0; i < length; i++) {
         spdlog::debug("Using Key: {}", keys[i]);
+        if (thread_placement_parse_arg(keys[i], values[i])) {
+            continue;
+        }
+        if (numa_placement_parse_arg(keys[i], values[i])) {
+            continue;
+        }
+        if (output_pool_parse_arg(keys[i], values[i], outputs_pool_options)) {
+            continue;
+        }
+        if (copy_engine_parse_arg(keys[i], values[i], copy_engine_options)) {
+            continue;
+        }
+        if (postprocess_parse_arg(keys[i], values[i], postprocess_options)) {
+            continue;
+        }
+        if (pipeline_parse_arg(keys[i], values[i], pipeline_options)) {
+            continue;
+        }
+        if (strcmp(keys[i], "output_callback_threads") == 0) {
+            output_delivery_threads = static_cast<size_t>(std::max(*static_cast<const int *>(values[i]), 1));
+            continue;
+        }
+        if (strcmp(keys[i], "output_callback_queue_depth") == 0) {
+            output_delivery_queue_depth = static_cast<size_t>(std::max(*static_cast<const int *>(values[i]), 1));
+            continue;
+        }
+        if (strcmp(keys[i], "input_staging") == 0) {
+            input_staging_enabled = *static_cast<const int *>(values[i]) != 0;
+            continue;
+        }
+        if (strcmp(keys[i], "input_staging_buffers") == 0) {
+            input_staging_buffers = static_cast<size_t>(std::max(*static_cast<const int *>(values[i]), 0));
+            continue;
+        }
+        if (strcmp(keys[i], "output_names") == 0) {
+            output_names_arg = static_cast<const char *>(values[i]);
+            continue;
+        }
+        if (strcmp(keys[i], "output_quantization") == 0) {
+            output_quantization_arg = static_cast<const char *>(values[i]);
+            continue;
+        }
+        if (strcmp(keys[i], "output_float_type") == 0) {
+            const char *type = static_cast<const char *>(values[i]);
+            if (strcmp(type, "float") == 0) {
+                output_float_type = DATA_TYPE_FLOAT;
+            } else if (strcmp(type, "float16") == 0) {
+                output_float_type = DATA_TYPE_FLOAT16;
+            } else if (strcmp(type, "bfloat16") == 0) {
+                output_float_type = DATA_TYPE_BFLOAT16;
+            } else {
+                spdlog::error("Invalid output_float_type: {}", type);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(keys[i], "output_layout") == 0) {
+            if (!output_layout_parse(static_cast<const char *>(values[i]), output_layout_conversion)) {
+                spdlog::error("Invalid output_layout: {}", static_cast<const char *>(values[i]));
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(keys[i], "fd_input_cache_size") == 0) {
+            fd_input_set_cache_size(static_cast<size_t>(std::max(*static_cast<const int *>(values[i]), 0)));
+            continue;
+        }
+        if (strcmp(keys[i], "tensors_allocator") == 0) {
+            if (set_tensors_allocator(static_cast<const tensors_allocator *>(values[i])) != 0) {
+                spdlog::error("Invalid tensors_allocator: alloc, aligned_alloc and free are required");
+                return 1;
+            }
+            spdlog::info("Using the host-provided tensors allocator");
+            continue;
+        }
     }
 
     return 0;
 }
 
-int runtime_model_loading(const char *file_path) {
+int runtime_context::load_model(const char *file_path) {
     {
         std::ifstream f(file_path, std::ios::binary);
         if (!f) {
@@ -243,36 +651,85 @@ int runtime_model_loading(const char *file_path) {
         NumDevice = dxrt::DeviceStatus::GetDeviceCount();
         OUTPUTS_POOL_CAPACITY = NumDevice * 10;
 
+        // Buffers are spread over the devices' local nodes. dxrt picks the device of each job, so a
+        // buffer is not tied to a device, but every node serving jobs gets its share of local memory.
+        numa_placement_init(NumDevice);
+        std::vector<int> device_nodes = numa_device_nodes();
+        if (device_nodes.size() == 1) {
+            thread_placement_set_default_cpus("wait", numa_node_cpus(device_nodes[0]));
+        }
+
         OutputTensorSizes = inference_engine->GetOutputTensorSizes();
+        OutputTensorNames.clear();
+        for (const auto &output : inference_engine->GetOutputs()) {
+            OutputTensorNames.push_back(output.name());
+        }
+        output_selection = parse_output_selection(output_names_arg.c_str());
+        if (!output_selection || !init_host_outputs() || !init_postprocessor()) {
+            delete inference_engine;
+            inference_engine = nullptr;
+            return 1;
+        }
+        if (output_selection->size() < OutputTensorNames.size()) {
+            spdlog::info("Returning {} of {} output tensors: {}", output_selection->size(), OutputTensorNames.size(), output_names_arg);
+        }
+
         uint64_t OutputSize = inference_engine->GetOutputSize();
-        {
-            std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-            while (!outputs_ptr_pool.empty()) outputs_ptr_pool.pop();
-            for (size_t i = 0; i < OUTPUTS_POOL_CAPACITY; ++i) {
-                void* outputs_ptr = malloc(OutputSize);
-                if (!outputs_ptr) {
-                    spdlog::error("Failed to allocate output buffer {}", i);
-                    continue;
-                }
-                outputs_ptr_pool.push(outputs_ptr);
+        std::vector<int> slot_nodes(NumDevice);
+        for (size_t i = 0; i < NumDevice; ++i) {
+            slot_nodes[i] = numa_node_of_device(i);
+        }
+        OutputPoolOptions pool_options = outputs_pool_options;
+        if (pool_options.min_slots == 0) {
+            pool_options.min_slots = OUTPUTS_POOL_CAPACITY;
+        }
+        if (!outputs_pool.init(OutputSize, slot_nodes, pool_options)) {
+            spdlog::error("Failed to allocate the output buffers");
+            delete inference_engine;
+            inference_engine = nullptr;
+            return 1;
+        }
+        spdlog::info("Initialized outputs_pool with {} buffers for {} devices", outputs_pool.capacity(), NumDevice);
+
+        InputSize = inference_engine->GetInputSize();
+        if (input_staging_enabled) {
+            OutputPoolOptions staging_options;
+            staging_options.min_slots = input_staging_buffers > 0 ? input_staging_buffers : OUTPUTS_POOL_CAPACITY;
+            if (!staging_pool.init(InputSize, slot_nodes, staging_options)) {
+                spdlog::error("Failed to allocate the input staging buffers");
+                outputs_pool.destroy();
+                delete inference_engine;
+                inference_engine = nullptr;
+                return 1;
             }
-            spdlog::info("Initialized outputs_ptr_pool with {} buffers for {} devices", outputs_ptr_pool.size(), NumDevice);
+            spdlog::info("Input staging enabled with {} buffers", staging_pool.capacity());
         }
-        outputs_pool_cv.notify_one();
 
         stop_wait_thread.store(false);
+        stop_staging_thread.store(false);
         try {
-            wait_thread = std::thread(wait_loop);
+            copy_engine.start(copy_engine_options);
+            start_pipeline();
+            start_delivery();
+            wait_thread = std::thread(&runtime_context::wait_loop, this);
             wait_thread_started.store(true);
+            if (input_staging_enabled) {
+                staging_thread = std::thread(&runtime_context::staging_loop, this);
+                staging_thread_started.store(true);
+            }
         } catch (...) {
-            spdlog::error("Failed to create wait thread");
-            {
-                std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-                while (!outputs_ptr_pool.empty()) {
-                    free(outputs_ptr_pool.front());
-                    outputs_ptr_pool.pop();
-                }
+            spdlog::error("Failed to create runtime threads");
+            if (wait_thread_started.load()) {
+                stop_wait_thread.store(true);
+                job_data_queue_cv.notify_all();
+                wait_thread.join();
+                wait_thread_started.store(false);
             }
+            pipeline.stop();
+            delivery.stop();
+            copy_engine.stop();
+            staging_pool.destroy();
+            outputs_pool.destroy();
             if (inference_engine) { delete inference_engine; inference_engine = nullptr; }
             return 1;
         }
@@ -284,38 +741,24 @@ int runtime_model_loading(const char *file_path) {
     }
 }
 
-int send_input(tensors_struct *input_tensors) {
-
-    if (input_tensors->num_tensors != 1) {
-        spdlog::error("[send_input] Invalid number of input tensors: {}", input_tensors->num_tensors);
+int runtime_context::submit_job(JobData &job_data, void *input_ptr, const char *caller) {
+    void *outputs_ptr = outputs_pool.acquire();
+    if (outputs_ptr == nullptr) {
+        spdlog::error("[{}] The runtime is shutting down", caller);
         return 1;
     }
-    
-    void *outputs_ptr = nullptr;
-    {
-        std::unique_lock<std::mutex> lock(outputs_pool_mutex);
-        outputs_pool_cv.wait(lock, [](){ return !outputs_ptr_pool.empty(); });
-        outputs_ptr = outputs_ptr_pool.front();
-        outputs_ptr_pool.pop();
-    }
+    return run_job(job_data, input_ptr, outputs_ptr, caller);
+}
 
-    int job_id = -1;
+// Starts the inference into an output buffer already taken from the pool, which is returned on failure.
+int runtime_context::run_job(JobData &job_data, void *input_ptr, void *outputs_ptr, const char *caller) {
     try {
-        job_id = inference_engine->RunAsync(static_cast<uint8_t *>(input_tensors->data[0]), nullptr, outputs_ptr);
+        job_data.job_id = inference_engine->RunAsync(input_ptr, nullptr, outputs_ptr);
     } catch (const std::exception& e) {
-        spdlog::error("[send_input] Failed to run inference : {}", e.what());
-        {
-            std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-            outputs_ptr_pool.push(outputs_ptr);
-            outputs_pool_cv.notify_one();
-        }
-        if (input_tensors) deep_free_tensors_struct(input_tensors);
+        spdlog::error("[{}] Failed to run inference : {}", caller, e.what());
+        outputs_pool.release(outputs_ptr);
         return 1;
     }
-
-    JobData job_data;
-    job_data.job_id = job_id;
-    job_data.input_tensors = input_tensors;
     job_data.outputs_ptr = outputs_ptr;
 
     {
@@ -327,149 +770,1149 @@ int send_input(tensors_struct *input_tensors) {
     return 0;
 }
 
-static void wait_loop() {
-    while (true) {
-        JobData job_data{};
-        {
-            std::unique_lock<std::mutex> lock(job_data_queue_mutex);
-            job_data_queue_cv.wait(lock, [](){ return stop_wait_thread.load() || !job_data_queue.empty(); });
-            if (stop_wait_thread.load() && job_data_queue.empty()) {
-                break;
-            }
-            job_data = job_data_queue.front();
-            job_data_queue.pop();
-        }
+// Submits the job directly, or hands it to the staging thread which copies the input first.
+int runtime_context::dispatch_job(JobData &job_data, const char *caller) {
+    {
+        std::lock_guard<std::mutex> lock(output_selection_mutex);
+        job_data.outputs = output_selection;
+    }
 
-        try {
-            job_data.dxrt_outputs = inference_engine->Wait(job_data.job_id);
-        } catch (...) {
-            spdlog::error("[wait_loop] Failed to wait for outputs. job_id: {}", job_data.job_id);
-            if (job_data.input_tensors) deep_free_tensors_struct(job_data.input_tensors);
-            if (job_data.outputs_ptr) {
-                std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-                outputs_ptr_pool.push(job_data.outputs_ptr);
-                outputs_pool_cv.notify_one();
-            }
-            continue;
-        }
+    if (!input_staging_enabled) {
+        return submit_job(job_data, const_cast<void *>(job_data.input_ptr), caller);
+    }
 
-        if (job_data.input_tensors) deep_free_tensors_struct(job_data.input_tensors);
+    job_data.staging_ptr = staging_pool.acquire();
+    if (job_data.staging_ptr == nullptr) {
+        spdlog::error("[{}] The runtime is shutting down", caller);
+        return 1;
+    }
+    stage_job(job_data);
+    return 0;
+}
 
-        {
-            std::lock_guard<std::mutex> lock(output_queue_mutex);
-            output_queue.push(job_data);
-            output_queue_cv.notify_one();
-        }
+// Hands a job holding a staging buffer to the staging thread.
+void runtime_context::stage_job(JobData &job_data) {
+    {
+        std::lock_guard<std::mutex> lock(staging_queue_mutex);
+        staging_queue.push(job_data);
     }
+    staging_queue_cv.notify_one();
 }
 
-int receive_output(tensors_struct **output_tensors) {
+int runtime_context::send_tensors(tensors_struct *input_tensors, uint64_t tag, const char *caller) {
+    if (input_tensors->num_tensors != 1) {
+        spdlog::error("[{}] Invalid number of input tensors: {}", caller, input_tensors->num_tensors);
+        return 1;
+    }
 
     JobData job_data;
-    {
-        std::unique_lock<std::mutex> lock(output_queue_mutex);
-        output_queue_cv.wait(lock, [](){ return stop_wait_thread.load() || !output_queue.empty(); });
-        if (stop_wait_thread.load() && output_queue.empty()) {
-            *output_tensors = nullptr;
-            return 1;
-        }
-        job_data = output_queue.front();
-        output_queue.pop();
+    job_data.input_tensors = input_tensors;
+    job_data.input_ptr = input_tensors->data[0];
+    job_data.tag = tag;
+
+    if (dispatch_job(job_data, caller) != 0) {
+        return 1;
     }
 
-    tensors_struct *output_tensors_struct = create_output_tensors_struct();
-    if (!output_tensors_struct) {
-        spdlog::error("[receive_output] Failed to allocate output tensors");
-        if (job_data.outputs_ptr) {
-            std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-            outputs_ptr_pool.push(job_data.outputs_ptr);
-            outputs_pool_cv.notify_one();
-        }
-        *output_tensors = nullptr;
+    return 0;
+}
+
+int runtime_context::send_fd(int fd, size_t offset, size_t size, input_release_callback release, void *user_ctx) {
+    if (inference_engine == nullptr) {
+        spdlog::error("[send_input_fd] No model is loaded");
+        return 1;
+    }
+    if (size < InputSize) {
+        spdlog::error("[send_input_fd] Input of {} bytes is smaller than the model input of {} bytes", size, InputSize);
         return 1;
     }
 
-    *output_tensors = copy_dxrt_outputs_to_output_tensors_struct(job_data.dxrt_outputs, output_tensors_struct);
-    if (*output_tensors == nullptr) {
-        spdlog::error("[receive_output] Failed to convert dxrt outputs to output tensors");
-        if (job_data.outputs_ptr) {
-            std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-            outputs_ptr_pool.push(job_data.outputs_ptr);
-            outputs_pool_cv.notify_one();
-        }
+    JobData job_data;
+    if (!fd_input_acquire(fd, offset, size, job_data.fd_input)) {
         return 1;
     }
+    job_data.input_ptr = job_data.fd_input.data;
+    job_data.release_input = release;
+    job_data.release_input_ctx = user_ctx;
 
-    if (job_data.outputs_ptr) {
-        std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-        outputs_ptr_pool.push(job_data.outputs_ptr);
-        outputs_pool_cv.notify_one();
+    if (dispatch_job(job_data, "send_input_fd") != 0) {
+        fd_input_release(job_data.fd_input);
+        return 1;
     }
 
     return 0;
 }
 
-int runtime_destruction() {
-    spdlog::info("Destroying the runtime environment");
+// Checks that caller-provided output tensors match the selected outputs in count, type and shape, and
+// that their buffers take the returned bytes as they are.
+bool runtime_context::check_output_tensors(const tensors_struct *output_tensors,
+                                           const std::vector<std::shared_ptr<dxrt::Tensor>> &outputs,
+                                           const std::vector<size_t> &selection) {
+    if (outputs.size() != OutputTensorSizes.size()) {
+        spdlog::error("[runtime_infer] Output tensor size mismatch: dxrt_outputs={}", outputs.size());
+        return false;
+    }
+    if (output_tensors->num_tensors != selection.size()) {
+        spdlog::error("[runtime_infer] Expected {} output tensors, got {}", selection.size(), output_tensors->num_tensors);
+        return false;
+    }
+    for (size_t i = 0; i < selection.size(); i++) {
+        const HostOutput &host = HostOutputs[selection[i]];
+        std::vector<int64_t> shape = host_output_shape(*outputs[selection[i]], selection[i]);
+        bool match = output_tensors->data[i] != nullptr && output_tensors->data_types[i] == host.type &&
+                     output_tensors->ranks[i] == shape.size();
+        uint64_t bytes = get_data_type_byte_size(host.type);
+        for (size_t j = 0; match && j < shape.size(); j++) {
+            match = output_tensors->shapes[i][j] == static_cast<size_t>(shape[j]);
+            bytes *= static_cast<uint64_t>(shape[j]);
+        }
+        if (!match || bytes != host.size) {
+            spdlog::error("[runtime_infer] Output tensor {} does not match output {}", i, OutputTensorNames[selection[i]]);
+            return false;
+        }
+    }
+    return true;
+}
 
-    stop_wait_thread.store(true);
-    job_data_queue_cv.notify_all();
-    output_queue_cv.notify_all();
-    outputs_pool_cv.notify_all();
+int runtime_context::infer(const tensors_struct *input_tensors, tensors_struct **output_tensors) {
+    if (inference_engine == nullptr) {
+        spdlog::error("[runtime_infer] No model is loaded");
+        return 1;
+    }
+    if (input_tensors->num_tensors != 1) {
+        spdlog::error("[runtime_infer] Invalid number of input tensors: {}", input_tensors->num_tensors);
+        return 1;
+    }
+    tensors_struct *provided = *output_tensors;
+    if (provided != nullptr && postprocessor) {
+        spdlog::error("[runtime_infer] Postprocess results cannot be written to provided output tensors");
+        return 1;
+    }
 
+    JobData job_data;
     {
-        std::lock_guard<std::mutex> lock(output_queue_mutex);
-        while (!output_queue.empty()) {
-            JobData r = std::move(output_queue.front());
-            output_queue.pop();
-            if (r.input_tensors) deep_free_tensors_struct(r.input_tensors);
-            if (r.outputs_ptr) free(r.outputs_ptr);
-        }
+        std::lock_guard<std::mutex> lock(output_selection_mutex);
+        job_data.outputs = output_selection;
+    }
+    job_data.outputs_ptr = outputs_pool.acquire();
+    if (job_data.outputs_ptr == nullptr) {
+        spdlog::error("[runtime_infer] The runtime is shutting down");
+        return 1;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(job_data_queue_mutex);
-        while (!job_data_queue.empty()) {
-            JobData j = job_data_queue.front();
-            job_data_queue.pop();
-            if (j.input_tensors) deep_free_tensors_struct(j.input_tensors);
-            if (j.outputs_ptr) free(j.outputs_ptr);
-        }
+    // dxrt runs the inference on this thread's behalf; nothing goes through the job and output queues.
+    try {
+        job_data.dxrt_outputs = inference_engine->Run(input_tensors->data[0], nullptr, job_data.outputs_ptr);
+    } catch (const std::exception& e) {
+        spdlog::error("[runtime_infer] Failed to run inference : {}", e.what());
+        outputs_pool.release(job_data.outputs_ptr);
+        return 1;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(outputs_pool_mutex);
-        while (!outputs_ptr_pool.empty()) {
-            void *outputs_ptr = outputs_ptr_pool.front();
-            outputs_ptr_pool.pop();
-            free(outputs_ptr);
+    if (provided != nullptr) {
+        bool valid = check_output_tensors(provided, job_data.dxrt_outputs, *job_data.outputs);
+        if (valid) {
+            std::vector<CopyTask> copy_tasks;
+            for (size_t i = 0; i < job_data.outputs->size(); i++) {
+                size_t index = (*job_data.outputs)[i];
+                dxrt::Tensor &output = *job_data.dxrt_outputs[index];
+                copy_output_data(output, index, host_output_shape(output, index), provided->data[i], copy_tasks);
+            }
+            copy_engine.copy(copy_tasks);
         }
+        job_data.dxrt_outputs.clear();
+        outputs_pool.release(job_data.outputs_ptr);
+        return valid ? 0 : 1;
     }
 
-    if (wait_thread_started.load()) {
-        if (wait_thread.joinable()) {
-            wait_thread.join();
-        }
-        wait_thread_started.store(false);
+    if (postprocessor) {
+        postprocess_job(job_data);
+    } else {
+        materialize_job(job_data);
     }
+    output_stage_job(job_data);
+    *output_tensors = job_data.result;
+    return job_data.failed ? 1 : 0;
+}
 
-    if (inference_engine != nullptr) {
-        delete inference_engine;
-        inference_engine = nullptr;
-        spdlog::info("Inference engine destroyed");
+int runtime_context::output_quantization(const char *output_name, output_quantization_params *params) {
+    if (output_name == nullptr || params == nullptr) {
+        spdlog::error("[runtime_output_quantization] output_name and params are required");
+        return 1;
+    }
+    auto it = std::find(OutputTensorNames.begin(), OutputTensorNames.end(), std::string(output_name));
+    if (it == OutputTensorNames.end()) {
+        return 1;
+    }
+    const OutputQuantization &quantization = HostOutputs[it - OutputTensorNames.begin()].quantization;
+    if (quantization.type == DATA_TYPE_UNDEFINED) {
+        return 1;
     }
 
-    spdlog::info("Runtime destruction completed");
-    if (logger) {
-        logger->flush();
-        logger.reset();
+    params->data_type = quantization.type;
+    params->num_channels = quantization.scales.size();
+    params->axis = quantization.scales.size() > 1 ? quantization.axis : -1;
+    params->scales = quantization.scales.data();
+    params->zero_points = quantization.zero_points.data();
+    return 0;
+}
+
+int runtime_context::select_outputs(const char *output_names) {
+    if (inference_engine == nullptr) {
+        spdlog::error("[runtime_select_outputs] No model is loaded");
+        return 1;
     }
 
+    std::shared_ptr<const std::vector<size_t>> selection = parse_output_selection(output_names);
+    if (!selection) {
+        return 1;
+    }
+    std::lock_guard<std::mutex> lock(output_selection_mutex);
+    output_selection = selection;
     return 0;
 }
 
-const char *runtime_error_message() { 
-    return ""; 
+static void release_job_input(JobData &job_data) {
+    if (job_data.input_tensors) {
+        deep_free_tensors_struct(job_data.input_tensors);
+        job_data.input_tensors = nullptr;
+    }
+    if (job_data.fd_input.entry) {
+        fd_input_release(job_data.fd_input);
+    }
+    if (job_data.release_input) {
+        job_data.release_input(job_data.release_input_ctx);
+        job_data.release_input = nullptr;
+    }
+}
+
+// A job dropped before it produced outputs is still reported to the output callback, so callers
+// tracking their requests by tag see every one of them complete.
+void runtime_context::abandon_job(JobData &job_data) {
+    release_job_input(job_data);
+    if (job_data.stream != nullptr) {
+        // The failure goes to the stream's queue, and returns the job's share of the stream quota
+        // once it is received.
+        JobData failed;
+        failed.stream = job_data.stream;
+        failed.failed = true;
+        push_output(failed);
+        return;
+    }
+    if (output_delivery != nullptr) {
+        output_delivery(1, nullptr, job_data.tag, output_delivery_ctx);
+    }
+}
+
+void runtime_context::staging_loop() {
+    thread_placement_apply("staging");
+
+    while (true) {
+        JobData job_data;
+        {
+            std::unique_lock<std::mutex> lock(staging_queue_mutex);
+            staging_queue_cv.wait(lock, [this](){ return stop_staging_thread.load() || !staging_queue.empty(); });
+            if (stop_staging_thread.load() && staging_queue.empty()) {
+                break;
+            }
+            job_data = staging_queue.front();
+            staging_queue.pop();
+        }
+
+        // The caller's buffer is released as soon as it is copied, not when the inference completes.
+        stream_copy(job_data.staging_ptr, job_data.input_ptr, InputSize);
+        release_job_input(job_data);
+        job_data.input_ptr = nullptr;
+
+        if (submit_job(job_data, job_data.staging_ptr, "staging_loop") != 0) {
+            spdlog::error("[staging_loop] Dropping a staged input");
+            staging_pool.release(job_data.staging_ptr);
+            abandon_job(job_data);
+        }
+    }
+}
+
+void runtime_context::wait_loop() {
+    thread_placement_apply("wait");
+
+    while (true) {
+        JobData job_data{};
+        {
+            std::unique_lock<std::mutex> lock(job_data_queue_mutex);
+            job_data_queue_cv.wait(lock, [this](){ return stop_wait_thread.load() || !job_data_queue.empty(); });
+            if (stop_wait_thread.load() && job_data_queue.empty()) {
+                break;
+            }
+            job_data = job_data_queue.front();
+            job_data_queue.pop();
+        }
+
+        try {
+            job_data.dxrt_outputs = inference_engine->Wait(job_data.job_id);
+        } catch (...) {
+            spdlog::error("[wait_loop] Failed to wait for outputs. job_id: {}", job_data.job_id);
+            abandon_job(job_data);
+            staging_pool.release(job_data.staging_ptr);
+            outputs_pool.release(job_data.outputs_ptr);
+            continue;
+        }
+
+        release_job_input(job_data);
+        staging_pool.release(job_data.staging_ptr);
+        job_data.staging_ptr = nullptr;
+
+        if (pipeline.running()) {
+            pipeline.submit(new JobData(std::move(job_data)));
+            continue;
+        }
+        if (postprocessor) {
+            postprocess_job(job_data);
+        }
+        if (delivery.running()) {
+            delivery.submit(new JobData(std::move(job_data)));
+            continue;
+        }
+
+        push_output(job_data);
+    }
+}
+
+// Admits the inputs of the streams in deficit round-robin order. The next stream is only picked once a
+// buffer is free, so that while the device is saturated every buffer released goes to the stream whose
+// turn it is rather than to the first stream to ask for it.
+void runtime_context::admission_loop() {
+    thread_placement_apply("admission");
+
+    OutputPool &slots = input_staging_enabled ? staging_pool : outputs_pool;
+    while (admission.wait_ready()) {
+        void *slot = slots.acquire();
+        if (slot == nullptr) {
+            break;
+        }
+        JobData *job_data = static_cast<JobData *>(admission.pop());
+        if (job_data == nullptr) {
+            slots.release(slot);
+            continue;
+        }
+
+        if (input_staging_enabled) {
+            job_data->staging_ptr = slot;
+            stage_job(*job_data);
+        } else if (run_job(*job_data, const_cast<void *>(job_data->input_ptr), slot, "admission_loop") != 0) {
+            abandon_job(*job_data);
+        }
+        delete job_data;
+    }
+}
+
+// The postprocess stage reads the device buffer in place, which is then recycled before the caller
+// picks up the result.
+void runtime_context::postprocess_job(JobData &job_data) {
+    static thread_local std::vector<PostprocessTensor> inputs;
+    inputs = PostprocessInputs;
+    for (size_t i = 0; i < inputs.size() && i < job_data.dxrt_outputs.size(); i++) {
+        inputs[i].data = job_data.dxrt_outputs[i]->data();
+    }
+    job_data.result = postprocessor->run(inputs);
+    if (job_data.result == nullptr) {
+        spdlog::error("[postprocess_job] Postprocessing failed. job_id: {}", job_data.job_id);
+        job_data.failed = true;
+    }
+    job_data.dxrt_outputs.clear();
+    outputs_pool.release(job_data.outputs_ptr);
+    job_data.outputs_ptr = nullptr;
+}
+
+// Copies the selected outputs out of the device buffer into the tensors returned to the caller.
+void runtime_context::materialize_job(JobData &job_data) {
+    if (job_data.failed || job_data.result != nullptr) {
+        return;
+    }
+
+    tensors_struct *output_tensors_struct = create_output_tensors_struct(*job_data.outputs);
+    if (!output_tensors_struct) {
+        spdlog::error("[materialize_job] Failed to allocate output tensors");
+        job_data.failed = true;
+    } else {
+        job_data.result = copy_dxrt_outputs_to_output_tensors_struct(job_data.dxrt_outputs, *job_data.outputs, output_tensors_struct);
+        if (job_data.result == nullptr) {
+            spdlog::error("[materialize_job] Failed to convert dxrt outputs to output tensors");
+            job_data.failed = true;
+        }
+    }
+
+    job_data.dxrt_outputs.clear();
+    outputs_pool.release(job_data.outputs_ptr);
+    job_data.outputs_ptr = nullptr;
+}
+
+void runtime_context::output_stage_job(JobData &job_data) {
+    if (output_stage == nullptr || job_data.failed) {
+        return;
+    }
+    if (output_stage(job_data.result, output_stage_ctx) != 0) {
+        spdlog::error("[output_stage_job] Output stage rejected the outputs. job_id: {}", job_data.job_id);
+        deep_free_tensors_struct(job_data.result);
+        job_data.result = nullptr;
+        job_data.failed = true;
+    }
+}
+
+// Hands the outputs, and their ownership, to the output callback.
+void runtime_context::deliver_job(JobData &job_data) {
+    output_delivery(job_data.failed ? 1 : 0, job_data.result, job_data.tag, output_delivery_ctx);
+    job_data.result = nullptr;
+}
+
+// With pipeline threads configured, the outputs are postprocessed, materialized and handed to the user
+// stage on the pipeline workers, overlapping across frames, instead of on the thread calling receive_output.
+// With an output callback, delivering them is the last stage.
+bool runtime_context::start_pipeline() {
+    if (pipeline_options.threads == 0) {
+        return false;
+    }
+    if (postprocessor) {
+        pipeline.add_stage("postprocess", [this](void *item) { postprocess_job(*static_cast<JobData *>(item)); });
+    } else {
+        pipeline.add_stage("output", [this](void *item) { materialize_job(*static_cast<JobData *>(item)); });
+    }
+    if (output_stage != nullptr) {
+        pipeline.add_stage("user", [this](void *item) { output_stage_job(*static_cast<JobData *>(item)); });
+    }
+    if (output_delivery == nullptr) {
+        return pipeline.start(pipeline_options, [this](void *item) {
+            JobData *job_data = static_cast<JobData *>(item);
+            push_output(*job_data);
+            delete job_data;
+        });
+    }
+
+    pipeline.add_stage("delivery", [this](void *item) { deliver_job(*static_cast<JobData *>(item)); });
+    PipelineOptions options = pipeline_options;
+    options.workers.insert(std::make_pair(std::string("delivery"), output_delivery_threads));
+    return pipeline.start(options, [](void *item) { delete static_cast<JobData *>(item); });
+}
+
+// Without the pipeline, an output callback gets its own pool of delivery threads. The wait thread blocks
+// once output_callback_queue_depth outputs are waiting for a callback, which in turn holds back send_input.
+bool runtime_context::start_delivery() {
+    if (output_delivery == nullptr || pipeline.running()) {
+        return false;
+    }
+    delivery.add_stage("delivery", [this](void *item) {
+        JobData &job_data = *static_cast<JobData *>(item);
+        materialize_job(job_data);
+        output_stage_job(job_data);
+        deliver_job(job_data);
+    });
+    PipelineOptions options;
+    options.threads = output_delivery_threads;
+    options.capacity = output_delivery_queue_depth;
+    options.workers["delivery"] = output_delivery_threads;
+    return delivery.start(options, [](void *item) { delete static_cast<JobData *>(item); });
+}
+
+void runtime_context::push_output(JobData &job_data) {
+    if (job_data.stream != nullptr) {
+        runtime_stream *stream = job_data.stream;
+        // Notified under the lock, since a receiver may complete the job and the stream be freed as soon as
+        // it is released. All waiters are woken, as a receiver and the stream's destruction may both wait.
+        std::lock_guard<std::mutex> lock(stream->outputs_mutex);
+        stream->outputs.push(std::move(job_data));
+        stream->outputs_cv.notify_all();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(output_queue_mutex);
+        output_queue.push(std::move(job_data));
+        output_notifier.set();
+    }
+    output_queue_cv.notify_one();
+}
+
+// Takes the next job off the output queue: 0 if a job was taken, 1 if the runtime is stopping and the
+// queue is drained, 2 if the queue is empty and wait is false.
+int runtime_context::pop_output(JobData &job_data, bool wait) {
+    std::unique_lock<std::mutex> lock(output_queue_mutex);
+    if (wait) {
+        output_queue_cv.wait(lock, [this](){ return stop_wait_thread.load() || !output_queue.empty(); });
+    }
+    if (output_queue.empty()) {
+        return stop_wait_thread.load() ? 1 : 2;
+    }
+    job_data = std::move(output_queue.front());
+    output_queue.pop();
+    // The descriptor stays readable once stopping, so that event loops wake up and see the failure.
+    if (output_queue.empty() && !stop_wait_thread.load()) {
+        output_notifier.clear();
+    }
+    return 0;
+}
+
+int runtime_context::finish_output(JobData &job_data, tensors_struct **output_tensors) {
+    // Jobs coming out of the pipeline are already complete.
+    if (!pipeline.running()) {
+        materialize_job(job_data);
+        output_stage_job(job_data);
+    }
+
+    *output_tensors = job_data.result;
+    return job_data.failed ? 1 : 0;
+}
+
+int runtime_context::receive(tensors_struct **output_tensors, bool wait, const char *caller) {
+    if (output_delivery != nullptr) {
+        spdlog::error("[{}] Outputs are delivered to the output callback", caller);
+        *output_tensors = nullptr;
+        return 1;
+    }
+    JobData job_data;
+    int ret = pop_output(job_data, wait);
+    if (ret != 0) {
+        *output_tensors = nullptr;
+        return ret == 2 ? RUNTIME_OUTPUT_NOT_READY : 1;
+    }
+    return finish_output(job_data, output_tensors);
+}
+
+int runtime_context::output_fd() {
+    std::lock_guard<std::mutex> lock(output_queue_mutex);
+    if (!output_notifier.open()) {
+        return -1;
+    }
+    if (!output_queue.empty() || stop_wait_thread.load()) {
+        output_notifier.set();
+    }
+    return output_notifier.fd();
+}
+
+// Starts the admission thread on first use. streams_mutex must be held.
+bool runtime_context::start_admission(const char *caller) {
+    if (admission_thread_started) {
+        return true;
+    }
+    try {
+        admission_thread = std::thread(&runtime_context::admission_loop, this);
+    } catch (...) {
+        spdlog::error("[{}] Failed to create the admission thread", caller);
+        return false;
+    }
+    admission_thread_started = true;
+    return true;
+}
+
+// Streams are admitted by the admission thread. Their outputs always go to the stream's queue, so
+// streams and the output callback exclude each other.
+runtime_stream *runtime_context::create_stream(int max_in_flight, int weight) {
+    if (inference_engine == nullptr) {
+        spdlog::error("[runtime_stream_create] No model is loaded");
+        return nullptr;
+    }
+    if (output_delivery != nullptr) {
+        spdlog::error("[runtime_stream_create] Outputs are delivered to the output callback");
+        return nullptr;
+    }
+
+    runtime_stream *stream = new (std::nothrow) runtime_stream();
+    if (stream == nullptr) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(streams_mutex);
+    if (!start_admission("runtime_stream_create")) {
+        delete stream;
+        return nullptr;
+    }
+    size_t quota = static_cast<size_t>(std::max(max_in_flight, 1));
+    stream->context = this;
+    stream->admission = admission.add_stream(quota, static_cast<size_t>(std::max(weight, 1)), quota);
+    streams.push_back(stream);
+    return stream;
+}
+
+// Drops the inputs not admitted yet, and waits for the admitted ones to drop their outputs.
+int runtime_context::destroy_stream(runtime_stream *stream) {
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex);
+        stream_destructions++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stream->outputs_mutex);
+        stream->closing = true;
+    }
+    stream->outputs_cv.notify_all();
+    for (void *item : admission.close_stream(stream->admission)) {
+        JobData *job_data = static_cast<JobData *>(item);
+        release_job_input(*job_data);
+        delete job_data;
+    }
+
+    // Every admitted job ends up in the stream's queue, also when the context shuts down meanwhile: the
+    // wait thread and the pipeline drain into it, and jobs still queued for the wait thread are abandoned
+    // to it. The stream can only be freed once none of them can reach it any more.
+    // Receivers take outputs concurrently, so the queue is rechecked together with the jobs in flight, which
+    // a receiver only drops after popping one.
+    while (true) {
+        JobData job_data;
+        {
+            std::unique_lock<std::mutex> lock(stream->outputs_mutex);
+            stream->outputs_cv.wait(lock, [this, stream]() {
+                return !stream->outputs.empty() || admission.in_flight(stream->admission) == 0;
+            });
+            if (stream->outputs.empty()) {
+                break;
+            }
+            job_data = std::move(stream->outputs.front());
+            stream->outputs.pop();
+        }
+        tensors_struct *output_tensors = nullptr;
+        finish_output(job_data, &output_tensors);
+        admission.complete(stream->admission);
+        if (output_tensors != nullptr) {
+            deep_free_tensors_struct(output_tensors);
+        }
+    }
+    wait_for_receivers(stream);
+
+    admission.remove_stream(stream->admission);
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex);
+        streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+        stream_destructions--;
+    }
+    streams_cv.notify_all();
+    delete stream;
+    return 0;
+}
+
+// Queues a job for the admission thread on the given stream's queue, or on the context's own queue when
+// stream is NULL.
+int runtime_context::schedule_job(runtime_stream *stream, tensors_struct *input_tensors, uint64_t tag, int priority,
+                                  uint64_t deadline_us, const char *caller) {
+    if (input_tensors->num_tensors != 1) {
+        spdlog::error("[{}] Invalid number of input tensors: {}", caller, input_tensors->num_tensors);
+        return 1;
+    }
+
+    StreamScheduler::Stream *queue = nullptr;
+    if (stream != nullptr) {
+        queue = stream->admission;
+    } else {
+        if (inference_engine == nullptr) {
+            spdlog::error("[{}] No model is loaded", caller);
+            return 1;
+        }
+        // Scheduled inputs without a stream share one queue without quota, bounded like the output pool.
+        std::lock_guard<std::mutex> lock(streams_mutex);
+        if (!start_admission(caller)) {
+            return 1;
+        }
+        if (scheduled_queue == nullptr) {
+            scheduled_queue = admission.add_stream(0, 1, outputs_pool.capacity());
+        }
+        queue = scheduled_queue;
+    }
+
+    JobData *job_data = new (std::nothrow) JobData();
+    if (job_data == nullptr) {
+        return 1;
+    }
+    job_data->input_tensors = input_tensors;
+    job_data->input_ptr = input_tensors->data[0];
+    job_data->tag = tag;
+    job_data->stream = stream;
+    {
+        std::lock_guard<std::mutex> lock(output_selection_mutex);
+        job_data->outputs = output_selection;
+    }
+
+    if (!admission.push(queue, job_data, priority, deadline_us)) {
+        spdlog::error("[{}] The stream is closed or the runtime is shutting down", caller);
+        delete job_data;
+        return 1;
+    }
+    return 0;
+}
+
+int runtime_context::stream_receive(runtime_stream *stream, tensors_struct **output_tensors, bool wait,
+                                    const char *caller) {
+    JobData job_data;
+    {
+        std::unique_lock<std::mutex> lock(stream->outputs_mutex);
+        if (wait) {
+            // Counted while blocked too, since a woken receiver still needs the stream to reacquire the lock.
+            stream->receivers++;
+            stream->outputs_cv.wait(lock, [this, stream]() {
+                return stop_wait_thread.load() || stream->closing || !stream->outputs.empty();
+            });
+            stream->receivers--;
+        }
+        if (stream->outputs.empty()) {
+            *output_tensors = nullptr;
+            int ret = RUNTIME_OUTPUT_NOT_READY;
+            if (stream->closing) {
+                spdlog::error("[{}] The stream is being destroyed", caller);
+                ret = 1;
+            } else if (stop_wait_thread.load()) {
+                spdlog::error("[{}] The runtime is shutting down", caller);
+                ret = 1;
+            }
+            // Notified under the lock: the stream may be freed as soon as it is released.
+            stream->outputs_cv.notify_all();
+            return ret;
+        }
+        job_data = std::move(stream->outputs.front());
+        stream->outputs.pop();
+        stream->receivers++;
+    }
+
+    int ret = finish_output(job_data, output_tensors);
+    admission.complete(stream->admission);
+    // Wakes the destruction of the stream, which waits for the job to complete and the receiver to leave.
+    // Notified under the lock, since the stream may be freed as soon as it is released.
+    std::lock_guard<std::mutex> lock(stream->outputs_mutex);
+    stream->receivers--;
+    stream->outputs_cv.notify_all();
+    return ret;
+}
+
+// Marks the stream as closing, and waits for the threads still finishing one of its outputs. Blocked
+// receivers return once the stream is closing, and the stream can then be freed.
+void runtime_context::wait_for_receivers(runtime_stream *stream) {
+    std::unique_lock<std::mutex> lock(stream->outputs_mutex);
+    stream->closing = true;
+    stream->outputs_cv.notify_all();
+    stream->outputs_cv.wait(lock, [stream]() { return stream->receivers == 0; });
+}
+
+int runtime_context::set_output_callback(output_delivery_callback callback, void *user_ctx) {
+    if (inference_engine != nullptr) {
+        spdlog::error("[runtime_set_output_callback] The output callback must be set before loading the model");
+        return 1;
+    }
+    output_delivery = callback;
+    output_delivery_ctx = user_ctx;
+    return 0;
+}
+
+int runtime_context::set_output_stage(output_stage_callback callback, void *user_ctx) {
+    if (inference_engine != nullptr) {
+        spdlog::error("[runtime_set_output_stage] The output stage must be set before loading the model");
+        return 1;
+    }
+    output_stage = callback;
+    output_stage_ctx = user_ctx;
+    return 0;
+}
+
+void runtime_context::destroy() {
+    // Stream inputs not admitted yet are dropped, like staged inputs still queued; inputs already on
+    // the device are drained below.
+    admission.shutdown();
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex);
+        if (admission_thread_started) {
+            if (admission_thread.joinable()) {
+                admission_thread.join();
+            }
+            admission_thread_started = false;
+        }
+        for (runtime_stream *stream : streams) {
+            stream->outputs_cv.notify_all();
+        }
+    }
+    stop_staging_thread.store(true);
+    staging_queue_cv.notify_all();
+    staging_pool.shutdown();
+    stop_wait_thread.store(true);
+    job_data_queue_cv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(output_queue_mutex);
+        output_notifier.set();
+    }
+    output_queue_cv.notify_all();
+    outputs_pool.shutdown();
+
+    if (staging_thread_started.load()) {
+        if (staging_thread.joinable()) {
+            staging_thread.join();
+        }
+        staging_thread_started.store(false);
+    }
+
+    // The wait thread drains the jobs already submitted to the device before exiting, and the pipeline
+    // then drains them to the output queue.
+    if (wait_thread_started.load()) {
+        if (wait_thread.joinable()) {
+            wait_thread.join();
+        }
+        wait_thread_started.store(false);
+    }
+    pipeline.stop();
+    delivery.stop();
+
+    {
+        std::lock_guard<std::mutex> lock(output_queue_mutex);
+        while (!output_queue.empty()) {
+            JobData r = std::move(output_queue.front());
+            output_queue.pop();
+            release_job_input(r);
+            if (r.result != nullptr) {
+                deep_free_tensors_struct(r.result);
+            }
+        }
+        output_notifier.close();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(job_data_queue_mutex);
+        while (!job_data_queue.empty()) {
+            JobData j = job_data_queue.front();
+            job_data_queue.pop();
+            abandon_job(j);
+        }
+    }
+
+    // Streams not destroyed by the host go with their context. Those the host is destroying finish
+    // draining first, as all their outputs are queued by now.
+    {
+        std::unique_lock<std::mutex> lock(streams_mutex);
+        streams_cv.wait(lock, [this]() { return stream_destructions == 0; });
+        for (runtime_stream *stream : streams) {
+            wait_for_receivers(stream);
+            while (!stream->outputs.empty()) {
+                JobData r = std::move(stream->outputs.front());
+                stream->outputs.pop();
+                release_job_input(r);
+                if (r.result != nullptr) {
+                    deep_free_tensors_struct(r.result);
+                }
+            }
+            delete stream;
+        }
+        streams.clear();
+    }
+    for (void *item : admission.reset()) {
+        JobData *job_data = static_cast<JobData *>(item);
+        if (job_data->stream == nullptr) {
+            abandon_job(*job_data);
+        } else {
+            release_job_input(*job_data);
+        }
+        delete job_data;
+    }
+    scheduled_queue = nullptr;
+
+    if (inference_engine != nullptr) {
+        delete inference_engine;
+        inference_engine = nullptr;
+        spdlog::info("Inference engine destroyed");
+    }
+
+    copy_engine.stop();
+    copy_engine_options = CopyEngineOptions();
+    outputs_pool.destroy();
+    outputs_pool_options = OutputPoolOptions();
+    staging_pool.destroy();
+    input_staging_enabled = false;
+    input_staging_buffers = 0;
+    output_names_arg.clear();
+    output_selection.reset();
+    OutputTensorNames.clear();
+    HostOutputs.clear();
+    postprocessor.reset();
+    postprocess_options = PostprocessOptions();
+    pipeline_options = PipelineOptions();
+    output_stage = nullptr;
+    output_stage_ctx = nullptr;
+    output_delivery = nullptr;
+    output_delivery_ctx = nullptr;
+    output_delivery_threads = 1;
+    output_delivery_queue_depth = 16;
+    PostprocessInputs.clear();
+    output_layout_conversion = LayoutConversion::NONE;
+    output_quantization_arg.clear();
+    output_float_type = DATA_TYPE_FLOAT;
+}
+
+const char *runtime_context::stats() {
+    std::ostringstream out;
+    out << "{\"numa\":" << numa_stats_json() << ",\"output_pool\":" << outputs_pool.stats_json()
+        << ",\"copy\":" << copy_engine.stats_json();
+    if (input_staging_enabled) {
+        out << ",\"staging_pool\":" << staging_pool.stats_json();
+    }
+    if (pipeline.running()) {
+        out << ",\"pipeline\":" << pipeline.stats_json();
+    }
+    if (delivery.running()) {
+        out << ",\"delivery\":" << delivery.stats_json();
+    }
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex);
+        if (!streams.empty() || scheduled_queue != nullptr) {
+            out << ",\"streams\":" << admission.stats_json();
+        }
+    }
+    out << "}";
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats_buffer = out.str();
+    return stats_buffer.c_str();
+}
+
+int runtime_model_loading(const char *file_path) {
+    return default_context.load_model(file_path);
+}
+
+int send_input(tensors_struct *input_tensors) {
+    return default_context.send_tensors(input_tensors, 0, "send_input");
+}
+
+int send_input_tagged(tensors_struct *input_tensors, uint64_t tag) {
+    return default_context.send_tensors(input_tensors, tag, "send_input_tagged");
+}
+
+int send_input_scheduled(tensors_struct *input_tensors, uint64_t tag, int priority, uint64_t deadline_us) {
+    return default_context.schedule_job(nullptr, input_tensors, tag, priority, deadline_us, "send_input_scheduled");
+}
+
+int send_input_fd(int fd, size_t offset, size_t size, input_release_callback release, void *user_ctx) {
+    return default_context.send_fd(fd, offset, size, release, user_ctx);
+}
+
+int runtime_infer(const tensors_struct *input_tensors, tensors_struct **output_tensors) {
+    return default_context.infer(input_tensors, output_tensors);
+}
+
+int runtime_output_quantization(const char *output_name, output_quantization_params *params) {
+    return default_context.output_quantization(output_name, params);
+}
+
+int runtime_select_outputs(const char *output_names) {
+    return default_context.select_outputs(output_names);
+}
+
+int receive_output(tensors_struct **output_tensors) {
+    return default_context.receive(output_tensors, true, "receive_output");
+}
+
+int try_receive_output(tensors_struct **output_tensors) {
+    return default_context.receive(output_tensors, false, "try_receive_output");
+}
+
+int runtime_output_fd() {
+    return default_context.output_fd();
+}
+
+int runtime_set_output_callback(output_delivery_callback callback, void *user_ctx) {
+    return default_context.set_output_callback(callback, user_ctx);
+}
+
+int runtime_set_output_stage(output_stage_callback callback, void *user_ctx) {
+    return default_context.set_output_stage(callback, user_ctx);
+}
+
+int runtime_destruction() {
+    spdlog::info("Destroying the runtime environment");
+    default_context.destroy();
+
+    // Process-wide settings go with the default context.
+    fd_input_reset();
+    thread_placement_reset();
+    numa_placement_reset();
+    set_tensors_allocator(nullptr);
+
+    spdlog::info("Runtime destruction completed");
+    if (logger) {
+        logger->flush();
+        logger.reset();
+    }
+
+    return 0;
+}
+
+const char *runtime_error_message() { 
+    return ""; 
+}
+
+const char *runtime_stats() {
+    return default_context.stats();
+}
+
+runtime_context *runtime_context_create(int length, const char **keys, const void **values) {
+    runtime_context *context = new (std::nothrow) runtime_context();
+    if (context == nullptr) {
+        return nullptr;
+    }
+    if (context->parse_args(length, keys, values) != 0) {
+        delete context;
+        return nullptr;
+    }
+    return context;
+}
+
+int runtime_context_model_loading(runtime_context *context, const char *file_path) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->load_model(file_path);
+}
+
+int runtime_context_send_input(runtime_context *context, tensors_struct *input_tensors) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->send_tensors(input_tensors, 0, "runtime_context_send_input");
+}
+
+int runtime_context_send_input_tagged(runtime_context *context, tensors_struct *input_tensors, uint64_t tag) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->send_tensors(input_tensors, tag, "runtime_context_send_input_tagged");
+}
+
+int runtime_context_send_input_scheduled(runtime_context *context, tensors_struct *input_tensors, uint64_t tag,
+                                         int priority, uint64_t deadline_us) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->schedule_job(nullptr, input_tensors, tag, priority, deadline_us,
+                                 "runtime_context_send_input_scheduled");
+}
+
+int runtime_context_send_input_fd(runtime_context *context, int fd, size_t offset, size_t size,
+                                  input_release_callback release, void *user_ctx) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->send_fd(fd, offset, size, release, user_ctx);
+}
+
+int runtime_context_infer(runtime_context *context, const tensors_struct *input_tensors,
+                          tensors_struct **output_tensors) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->infer(input_tensors, output_tensors);
+}
+
+int runtime_context_receive_output(runtime_context *context, tensors_struct **output_tensors) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->receive(output_tensors, true, "runtime_context_receive_output");
+}
+
+int runtime_context_try_receive_output(runtime_context *context, tensors_struct **output_tensors) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->receive(output_tensors, false, "runtime_context_try_receive_output");
+}
+
+int runtime_context_output_fd(runtime_context *context) {
+    if (context == nullptr) {
+        return -1;
+    }
+    return context->output_fd();
+}
+
+int runtime_context_output_quantization(runtime_context *context, const char *output_name,
+                                        output_quantization_params *params) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->output_quantization(output_name, params);
+}
+
+int runtime_context_select_outputs(runtime_context *context, const char *output_names) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->select_outputs(output_names);
+}
+
+int runtime_context_set_output_callback(runtime_context *context, output_delivery_callback callback, void *user_ctx) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->set_output_callback(callback, user_ctx);
+}
+
+int runtime_context_set_output_stage(runtime_context *context, output_stage_callback callback, void *user_ctx) {
+    if (context == nullptr) {
+        return 1;
+    }
+    return context->set_output_stage(callback, user_ctx);
+}
+
+const char *runtime_context_stats(runtime_context *context) {
+    if (context == nullptr) {
+        return nullptr;
+    }
+    return context->stats();
+}
+
+int runtime_context_destruction(runtime_context *context) {
+    if (context == nullptr) {
+        return 1;
+    }
+    context->destroy();
+    delete context;
+    return 0;
+}
+
+runtime_stream *runtime_stream_create(int max_in_flight, int weight) {
+    return default_context.create_stream(max_in_flight, weight);
+}
+
+runtime_stream *runtime_context_stream_create(runtime_context *context, int max_in_flight, int weight) {
+    if (context == nullptr) {
+        return nullptr;
+    }
+    return context->create_stream(max_in_flight, weight);
+}
+
+int runtime_stream_send_input(runtime_stream *stream, tensors_struct *input_tensors) {
+    if (stream == nullptr) {
+        return 1;
+    }
+    return stream->context->schedule_job(stream, input_tensors, 0, 0, 0, "runtime_stream_send_input");
+}
+
+int runtime_stream_send_input_scheduled(runtime_stream *stream, tensors_struct *input_tensors, int priority,
+                                        uint64_t deadline_us) {
+    if (stream == nullptr) {
+        return 1;
+    }
+    return stream->context->schedule_job(stream, input_tensors, 0, priority, deadline_us,
+                                         "runtime_stream_send_input_scheduled");
+}
+
+int runtime_stream_receive_output(runtime_stream *stream, tensors_struct **output_tensors) {
+    if (stream == nullptr) {
+        return 1;
+    }
+    return stream->context->stream_receive(stream, output_tensors, true, "runtime_stream_receive_output");
+}
+
+int runtime_stream_try_receive_output(runtime_stream *stream, tensors_struct **output_tensors) {
+    if (stream == nullptr) {
+        return 1;
+    }
+    return stream->context->stream_receive(stream, output_tensors, false, "runtime_stream_try_receive_output");
+}
+
+int runtime_stream_destruction(runtime_stream *stream) {
+    if (stream == nullptr) {
+        return 1;
+    }
+    return stream->context->destroy_stream(stream);
+}
+
+uint64_t runtime_clock_us() {
+    return scheduler_clock_us();
 }
 
 const char *runtime_version() { 
@@ -0,0 +1,131 @@
+#include "segmentation_postprocess.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEGMENTATION_SSE2 1
+#endif
+
+// Pixels reduced together: the running maximum, index and sum of a block take 12 KiB.
+static const size_t BLOCK = 1024;
+
+SegmentationPostprocessor::SegmentationPostprocessor(const PostprocessOptions &options) : options_(options) {}
+
+bool SegmentationPostprocessor::init(const std::vector<PostprocessTensor> &outputs) {
+    output_ = postprocess_find_output(outputs, options_);
+    if (output_ < 0) {
+        spdlog::error("[segmentation] Output '{}' not found", options_.output);
+        return false;
+    }
+    const PostprocessTensor &tensor = outputs[output_];
+    const std::vector<int64_t> &shape = tensor.shape;
+    int64_t batch = 1;
+    for (size_t d = 0; d + 3 < shape.size(); d++) {
+        batch *= shape[d];
+    }
+    if (tensor.type != DATA_TYPE_FLOAT || shape.size() < 3 || batch != 1) {
+        spdlog::error("[segmentation] Output {} must be a float tensor of shape [1, C, H, W]", tensor.name);
+        return false;
+    }
+    channels_ = static_cast<size_t>(std::max<int64_t>(shape[shape.size() - 3], 0));
+    height_ = static_cast<size_t>(std::max<int64_t>(shape[shape.size() - 2], 0));
+    width_ = static_cast<size_t>(std::max<int64_t>(shape[shape.size() - 1], 0));
+    if (channels_ == 0 || channels_ > 256 || height_ * width_ == 0) {
+        spdlog::error("[segmentation] Output {} must have between 1 and 256 channels", tensor.name);
+        return false;
+    }
+    spdlog::info("[segmentation] {} classes over {}x{} pixels{}", channels_, height_, width_,
+                 options_.confidence ? ", with confidence" : "");
+    return true;
+}
+
+// best and index hold the first plane; every other plane raises them where it scores strictly higher,
+// so ties resolve to the lowest channel.
+static void argmax_block(const float *scores, size_t plane, size_t channels, size_t count, float *best,
+                         int32_t *index) {
+    memcpy(best, scores, count * sizeof(float));
+    std::fill(index, index + count, 0);
+    for (size_t c = 1; c < channels; c++) {
+        const float *row = scores + c * plane;
+        size_t p = 0;
+#if defined(SEGMENTATION_SSE2)
+        const __m128i channel = _mm_set1_epi32(static_cast<int32_t>(c));
+        for (; p + 4 <= count; p += 4) {
+            __m128 value = _mm_loadu_ps(row + p);
+            __m128 current = _mm_loadu_ps(best + p);
+            __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(value, current));
+            __m128i current_index = _mm_loadu_si128(reinterpret_cast<const __m128i *>(index + p));
+            _mm_storeu_ps(best + p, _mm_max_ps(value, current));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(index + p),
+                             _mm_or_si128(_mm_andnot_si128(greater, current_index), _mm_and_si128(greater, channel)));
+        }
+#endif
+        for (; p < count; p++) {
+            if (row[p] > best[p]) {
+                best[p] = row[p];
+                index[p] = static_cast<int32_t>(c);
+            }
+        }
+    }
+}
+
+static void narrow_labels(const int32_t *index, uint8_t *labels, size_t count) {
+    size_t p = 0;
+#if defined(SEGMENTATION_SSE2)
+    for (; p + 16 <= count; p += 16) {
+        const __m128i *in = reinterpret_cast<const __m128i *>(index + p);
+        __m128i low = _mm_packs_epi32(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+        __m128i high = _mm_packs_epi32(_mm_loadu_si128(in + 2), _mm_loadu_si128(in + 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(labels + p), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; p < count; p++) {
+        labels[p] = static_cast<uint8_t>(index[p]);
+    }
+}
+
+tensors_struct *SegmentationPostprocessor::run(const std::vector<PostprocessTensor> &outputs) {
+    const float *scores = static_cast<const float *>(outputs[output_].data);
+    size_t plane = height_ * width_;
+
+    std::vector<PostprocessResultTensor> tensors{{"labels", DATA_TYPE_UINT8, {height_, width_}}};
+    if (options_.confidence) {
+        tensors.push_back(PostprocessResultTensor{"confidence", DATA_TYPE_FLOAT, {height_, width_}});
+    }
+    tensors_struct *result = postprocess_allocate_result(tensors);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    uint8_t *labels = static_cast<uint8_t *>(result->data[0]);
+    float *confidence = options_.confidence ? static_cast<float *>(result->data[1]) : nullptr;
+
+    float best[BLOCK];
+    int32_t index[BLOCK];
+    float sum[BLOCK];
+    for (size_t p0 = 0; p0 < plane; p0 += BLOCK) {
+        size_t count = std::min(BLOCK, plane - p0);
+        argmax_block(scores + p0, plane, channels_, count, best, index);
+        narrow_labels(index, labels + p0, count);
+        if (confidence == nullptr) continue;
+
+        if (!options_.softmax) {
+            memcpy(confidence + p0, best, count * sizeof(float));
+            continue;
+        }
+        // The softmax probability of the best channel is 1 / sum(exp(score - best)).
+        std::fill(sum, sum + count, 0.0f);
+        for (size_t c = 0; c < channels_; c++) {
+            postprocess_exp_accumulate(scores + c * plane + p0, best, sum, count);
+        }
+        for (size_t p = 0; p < count; p++) {
+            confidence[p0 + p] = 1.0f / sum[p];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,28 @@
+#ifndef SEGMENTATION_POSTPROCESS_H
+#define SEGMENTATION_POSTPROCESS_H
+
+#include "postprocess.h"
+
+/**
+ * @brief Reduces a [1, C, H, W] score map to a per-pixel label map.
+ *
+ * The channel argmax is computed over blocks of pixels, streaming each channel plane of the block through a
+ * running maximum held in L1, so the score map is read once in order. The result is a "labels" uint8 tensor
+ * of shape [H, W], followed by a "confidence" float tensor of the same shape when requested.
+ */
+class SegmentationPostprocessor : public Postprocessor {
+public:
+    explicit SegmentationPostprocessor(const PostprocessOptions &options);
+
+    bool init(const std::vector<PostprocessTensor> &outputs) override;
+    tensors_struct *run(const std::vector<PostprocessTensor> &outputs) override;
+
+private:
+    PostprocessOptions options_;
+    int output_ = -1;
+    size_t channels_ = 0;
+    size_t height_ = 0;
+    size_t width_ = 0;
+};
+
+#endif // SEGMENTATION_POSTPROCESS_H
@@ -0,0 +1,44 @@
+#include "stream_copy.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STREAM_COPY_SSE2 1
+#endif
+
+void stream_copy(void *dst, const void *src, size_t n) {
+#if defined(STREAM_COPY_SSE2)
+    uint8_t *d = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+
+    // Streaming stores need a 16-byte aligned destination; copy the unaligned head normally.
+    size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+    if (head > n) head = n;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    size_t blocks = n / 64;
+    for (size_t i = 0; i < blocks; i++) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 48), e);
+        s += 64;
+        d += 64;
+    }
+    n -= blocks * 64;
+    _mm_sfence();
+
+    memcpy(d, s, n);
+#else
+    memcpy(dst, src, n);
+#endif
+}
@@ -0,0 +1,15 @@
+#ifndef STREAM_COPY_H
+#define STREAM_COPY_H
+
+#include <stddef.h>
+
+/**
+ * @brief Copies n bytes with non-temporal stores, so the destination does not evict the caller's
+ * working set from the cache.
+ *
+ * Uses SSE2 streaming stores on x86; other architectures fall back to memcpy. The stores are fenced
+ * before returning, so the data is visible to other threads once the function returns.
+ */
+void stream_copy(void *dst, const void *src, size_t n);
+
+#endif // STREAM_COPY_H
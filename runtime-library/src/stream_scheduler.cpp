@@ -0,0 +1,235 @@
+#include "stream_scheduler.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+static double elapsed_us(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+uint64_t scheduler_clock_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+StreamScheduler::~StreamScheduler() {
+    shutdown();
+}
+
+StreamScheduler::Stream *StreamScheduler::add_stream(size_t max_in_flight, size_t weight, size_t queue_depth) {
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->max_in_flight = max_in_flight;
+    stream->weight = std::max<size_t>(weight, 1);
+    stream->queue_depth = std::max<size_t>(queue_depth, 1);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream->id = next_id_++;
+    streams_.push_back(std::move(stream));
+    return streams_.back().get();
+}
+
+std::vector<void *> StreamScheduler::close_stream(Stream *stream) {
+    std::vector<void *> items;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream->closed = true;
+        for (const auto &pending : stream->pending) {
+            items.push_back(pending.item);
+        }
+        stream->pending.clear();
+    }
+    space_cv_.notify_all();
+    return items;
+}
+
+void StreamScheduler::remove_stream(Stream *stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < streams_.size(); i++) {
+        if (streams_[i].get() != stream) {
+            continue;
+        }
+        streams_.erase(streams_.begin() + i);
+        // The stream after the removed one keeps its turn.
+        if (current_ > i) {
+            current_--;
+        }
+        if (current_ >= streams_.size()) {
+            current_ = 0;
+        }
+        return;
+    }
+}
+
+bool StreamScheduler::push(Stream *stream, void *item, int priority, uint64_t deadline_us) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!shutdown_ && !stream->closed && stream->pending.size() >= stream->queue_depth) {
+            stream->blocked_sends++;
+            space_cv_.wait(lock, [this, stream]() {
+                return shutdown_ || stream->closed || stream->pending.size() < stream->queue_depth;
+            });
+        }
+        if (shutdown_ || stream->closed) {
+            return false;
+        }
+        stream->pending.insert(Stream::Pending{item, priority, deadline_us, next_sequence_++, Clock::now()});
+        stream->high_water = std::max(stream->high_water, stream->pending.size());
+    }
+    ready_cv_.notify_one();
+    return true;
+}
+
+bool StreamScheduler::wait_ready() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait(lock, [this]() { return shutdown_ || any_eligible(); });
+    return !shutdown_;
+}
+
+void *StreamScheduler::pop() {
+    void *item = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool found = false;
+        int top = std::numeric_limits<int>::min();
+        for (const auto &stream : streams_) {
+            if (eligible(*stream)) {
+                top = std::max(top, stream->pending.begin()->priority);
+                found = true;
+            }
+        }
+        if (!found) {
+            return nullptr;
+        }
+
+        // Deadlines go first within the class, without using up the round-robin turn.
+        Stream *earliest = nullptr;
+        for (const auto &stream : streams_) {
+            if (!eligible(*stream)) {
+                continue;
+            }
+            const Stream::Pending &head = *stream->pending.begin();
+            if (head.priority == top && head.deadline_us != 0 &&
+                (earliest == nullptr || head < *earliest->pending.begin())) {
+                earliest = stream.get();
+            }
+        }
+        if (earliest != nullptr) {
+            earliest->deadline_admissions++;
+            item = admit(*earliest);
+        }
+
+        for (size_t visited = 0; item == nullptr && visited < streams_.size(); visited++) {
+            Stream &stream = *streams_[current_];
+            if (!eligible(stream) || stream.pending.begin()->priority != top) {
+                // An idle, throttled or outranked stream does not bank its turn.
+                stream.deficit = 0;
+                current_ = (current_ + 1) % streams_.size();
+                continue;
+            }
+            if (stream.deficit == 0) {
+                stream.deficit = stream.weight;
+            }
+
+            item = admit(stream);
+            stream.deficit--;
+            if (stream.deficit == 0 || !eligible(stream)) {
+                stream.deficit = 0;
+                current_ = (current_ + 1) % streams_.size();
+            }
+        }
+    }
+    if (item != nullptr) {
+        space_cv_.notify_all();
+    }
+    return item;
+}
+
+// Takes the head of an eligible stream's queue.
+void *StreamScheduler::admit(Stream &stream) {
+    Stream::Pending pending = *stream.pending.begin();
+    stream.pending.erase(stream.pending.begin());
+    if (stream.max_in_flight > 0) {
+        stream.in_flight++;
+    }
+    stream.admitted++;
+    if (pending.deadline_us != 0 && scheduler_clock_us() > pending.deadline_us) {
+        stream.late++;
+    }
+    double wait_us = elapsed_us(Clock::now() - pending.queued);
+    stream.wait_us += wait_us;
+    stream.wait_us_max = std::max(stream.wait_us_max, wait_us);
+    return pending.item;
+}
+
+void StreamScheduler::complete(Stream *stream) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stream->in_flight > 0) {
+            stream->in_flight--;
+        }
+        stream->completed++;
+    }
+    ready_cv_.notify_one();
+}
+
+void StreamScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    ready_cv_.notify_all();
+    space_cv_.notify_all();
+}
+
+std::vector<void *> StreamScheduler::reset() {
+    std::vector<void *> items;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &stream : streams_) {
+        for (const auto &pending : stream->pending) {
+            items.push_back(pending.item);
+        }
+    }
+    streams_.clear();
+    current_ = 0;
+    shutdown_ = false;
+    return items;
+}
+
+size_t StreamScheduler::in_flight(Stream *stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stream->in_flight;
+}
+
+std::string StreamScheduler::stats_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    out << "[";
+    for (size_t i = 0; i < streams_.size(); i++) {
+        const Stream &stream = *streams_[i];
+        double admitted = static_cast<double>(std::max<uint64_t>(stream.admitted, 1));
+        out << (i > 0 ? "," : "") << "{\"id\":" << stream.id << ",\"weight\":" << stream.weight
+            << ",\"max_in_flight\":" << stream.max_in_flight << ",\"pending\":" << stream.pending.size()
+            << ",\"in_flight\":" << stream.in_flight << ",\"admitted\":" << stream.admitted
+            << ",\"completed\":" << stream.completed << ",\"high_water\":" << stream.high_water
+            << ",\"blocked_sends\":" << stream.blocked_sends
+            << ",\"deadline_admissions\":" << stream.deadline_admissions << ",\"late\":" << stream.late
+            << ",\"wait_us_avg\":" << static_cast<uint64_t>(stream.wait_us / admitted)
+            << ",\"wait_us_max\":" << static_cast<uint64_t>(stream.wait_us_max) << "}";
+    }
+    out << "]";
+    return out.str();
+}
+
+bool StreamScheduler::eligible(const Stream &stream) const {
+    return !stream.pending.empty() && (stream.max_in_flight == 0 || stream.in_flight < stream.max_in_flight);
+}
+
+bool StreamScheduler::any_eligible() const {
+    for (const auto &stream : streams_) {
+        if (eligible(*stream)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,163 @@
+#ifndef STREAM_SCHEDULER_H
+#define STREAM_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @return The time deadlines are expressed in, in microseconds of the monotonic clock.
+ */
+uint64_t scheduler_clock_us();
+
+/**
+ * @brief Admits the inputs of several streams to the device by priority, deadline and deficit round-robin.
+ *
+ * Each stream has its own pending queue and a quota of inputs in flight, counted from pop() until the
+ * runtime reports the output as received through complete(). A stream is eligible while it has pending
+ * inputs and is under its quota, and it is represented by the input at the head of its queue: the one
+ * with the highest priority, then the earliest deadline, then the first pushed.
+ *
+ * pop() only considers the eligible streams whose head is in the highest priority class. Among them, the
+ * head with the earliest deadline goes first. Heads without a deadline are served in turn, up to weight
+ * inputs per stream and round, and a stream that runs out of eligible inputs loses the rest of its turn,
+ * so a bursty stream never takes more than its share of the device and of the output buffers while others
+ * of its class are waiting. push() blocks while the stream's pending queue holds queue_depth inputs.
+ */
+class StreamScheduler {
+public:
+    struct Stream;
+
+    StreamScheduler() = default;
+    ~StreamScheduler();
+
+    StreamScheduler(const StreamScheduler &) = delete;
+    StreamScheduler &operator=(const StreamScheduler &) = delete;
+
+    /**
+     * @param max_in_flight Inputs of the stream admitted and not yet received, 0 for no quota. Streams
+     *                      without a quota are not tracked by complete().
+     * @param weight Inputs admitted per round while the stream is eligible, at least 1.
+     * @param queue_depth Inputs waiting to be admitted before push() blocks, at least 1.
+     */
+    Stream *add_stream(size_t max_in_flight, size_t weight, size_t queue_depth);
+
+    /**
+     * @brief Stops accepting inputs for the stream and hands back those not admitted yet.
+     */
+    std::vector<void *> close_stream(Stream *stream);
+
+    /**
+     * @brief Forgets a closed stream once none of its inputs is in flight.
+     */
+    void remove_stream(Stream *stream);
+
+    /**
+     * @brief Queues an input of the stream, blocking while its pending queue is full.
+     *
+     * @param priority Higher classes are admitted first.
+     * @param deadline_us Absolute deadline on scheduler_clock_us(), 0 for none.
+     * @return false if the stream is closed or the scheduler shut down.
+     */
+    bool push(Stream *stream, void *item, int priority, uint64_t deadline_us);
+
+    /**
+     * @brief Waits until a stream is eligible.
+     *
+     * @return false if the scheduler was shut down while waiting.
+     */
+    bool wait_ready();
+
+    /**
+     * @brief Takes the next input in deficit round-robin order without blocking.
+     *
+     * @return The input, or nullptr if no stream is eligible.
+     */
+    void *pop();
+
+    /**
+     * @brief Returns one of the stream's in-flight inputs to its quota.
+     */
+    void complete(Stream *stream);
+
+    /**
+     * @brief Makes push() fail and wakes up all threads blocked in push() or wait_ready().
+     */
+    void shutdown();
+
+    /**
+     * @brief Closes every stream and hands back their pending inputs, then accepts new streams again.
+     */
+    std::vector<void *> reset();
+
+    size_t in_flight(Stream *stream);
+
+    /**
+     * @return The per-stream admission statistics as a JSON array.
+     */
+    std::string stats_json();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool eligible(const Stream &stream) const;
+    bool any_eligible() const;
+    void *admit(Stream &stream);
+
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::condition_variable space_cv_;
+    bool shutdown_ = false;
+    uint64_t next_id_ = 0;
+    uint64_t next_sequence_ = 0;
+    std::vector<std::unique_ptr<Stream>> streams_;
+    size_t current_ = 0;        // Stream whose turn it is
+};
+
+struct StreamScheduler::Stream {
+    struct Pending {
+        void *item;
+        int priority;
+        uint64_t deadline_us;
+        uint64_t sequence;
+        Clock::time_point queued;
+
+        // Highest priority first, then earliest deadline, inputs without a deadline last, then push order.
+        bool operator<(const Pending &other) const {
+            if (priority != other.priority) return priority > other.priority;
+            if (deadline_us != other.deadline_us) {
+                if (deadline_us == 0 || other.deadline_us == 0) return other.deadline_us == 0;
+                return deadline_us < other.deadline_us;
+            }
+            return sequence < other.sequence;
+        }
+    };
+
+    uint64_t id = 0;
+    size_t max_in_flight = 1;
+    size_t weight = 1;
+    size_t queue_depth = 1;
+    bool closed = false;
+
+    std::set<Pending> pending;
+    size_t in_flight = 0;
+    size_t deficit = 0;         // Inputs left in the stream's current turn
+
+    uint64_t admitted = 0;
+    uint64_t completed = 0;
+    uint64_t blocked_sends = 0;
+    uint64_t deadline_admissions = 0;   // Admitted ahead of the round-robin order for their deadline
+    uint64_t late = 0;                  // Admitted after their deadline
+    size_t high_water = 0;
+    double wait_us = 0.0;
+    double wait_us_max = 0.0;
+};
+
+#endif // STREAM_SCHEDULER_H
@@ -0,0 +1,22 @@
+#include "string_list.h"
+
+#include <sstream>
+
+static const char *WHITESPACE = " \t\r\n";
+
+std::string trim_whitespace(const std::string &text) {
+    size_t first = text.find_first_not_of(WHITESPACE);
+    if (first == std::string::npos) return std::string();
+    size_t last = text.find_last_not_of(WHITESPACE);
+    return text.substr(first, last - first + 1);
+}
+
+std::vector<std::string> split_list(const std::string &text, char separator) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, separator)) {
+        items.push_back(trim_whitespace(item));
+    }
+    return items;
+}
@@ -0,0 +1,19 @@
+#ifndef STRING_LIST_H
+#define STRING_LIST_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Removes the leading and trailing spaces, tabs and line breaks.
+ */
+std::string trim_whitespace(const std::string &text);
+
+/**
+ * @brief Splits a list-valued initialization argument such as "a, b,c" into trimmed items.
+ *
+ * Empty items are kept, except after a trailing separator, so that callers decide whether to skip them.
+ */
+std::vector<std::string> split_list(const std::string &text, char separator);
+
+#endif // STRING_LIST_H
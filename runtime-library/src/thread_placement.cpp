@@ -0,0 +1,194 @@
+#include "thread_placement.h"
+#include "string_list.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+static std::map<std::string, ThreadPlacement> thread_placements;
+static std::map<std::string, std::vector<int>> default_thread_cpus;
+static std::mutex thread_placements_mutex;
+
+static const char *CPUS_SUFFIX = "_thread_cpus";
+static const char *SCHED_PRIORITY_SUFFIX = "_thread_sched_priority";
+static const char *NICE_SUFFIX = "_thread_nice";
+
+#if defined(__linux__)
+static const long MAX_CPUS = CPU_SETSIZE;
+#else
+static const long MAX_CPUS = 1024;
+#endif
+
+static bool split_role_key(const std::string &key, const char *suffix, std::string &role) {
+    size_t suffix_len = strlen(suffix);
+    if (key.size() <= suffix_len || key.compare(key.size() - suffix_len, suffix_len, suffix) != 0) {
+        return false;
+    }
+    role = key.substr(0, key.size() - suffix_len);
+    return true;
+}
+
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus) {
+    cpus.clear();
+    for (const auto &item : split_list(text, ',')) {
+        if (item.empty()) continue;
+
+        char *rest = nullptr;
+        long first = strtol(item.c_str(), &rest, 10);
+        long last = first;
+        if (rest == item.c_str() || first < 0) return false;
+        if (*rest == '-') {
+            const char *second = rest + 1;
+            last = strtol(second, &rest, 10);
+            if (rest == second || last < first) return false;
+        }
+        if (*rest != '\0' || last >= MAX_CPUS) return false;
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return !cpus.empty();
+}
+
+bool thread_placement_parse_arg(const char *key, const void *value) {
+    std::string role;
+    std::string k(key);
+    std::lock_guard<std::mutex> lock(thread_placements_mutex);
+
+    if (split_role_key(k, CPUS_SUFFIX, role)) {
+        std::vector<int> cpus;
+        if (!parse_cpu_list(static_cast<const char *>(value), cpus)) {
+            spdlog::error("Ignoring invalid CPU list for {}: '{}'", key, static_cast<const char *>(value));
+            return true;
+        }
+#if defined(__linux__)
+        long configured = sysconf(_SC_NPROCESSORS_CONF);
+        int highest = *std::max_element(cpus.begin(), cpus.end());
+        if (configured > 0 && highest >= configured) {
+            spdlog::error("Ignoring CPU list for {}: CPU {} does not exist, the system has {} CPUs", key,
+                          highest, configured);
+            return true;
+        }
+#endif
+        thread_placements[role].cpus = cpus;
+        return true;
+    }
+    if (split_role_key(k, SCHED_PRIORITY_SUFFIX, role)) {
+        thread_placements[role].sched_fifo_priority = *static_cast<const int *>(value);
+        return true;
+    }
+    if (split_role_key(k, NICE_SUFFIX, role)) {
+        thread_placements[role].set_nice = true;
+        thread_placements[role].nice = *static_cast<const int *>(value);
+        return true;
+    }
+    return false;
+}
+
+void thread_placement_set_default_cpus(const char *role, const std::vector<int> &cpus) {
+    std::lock_guard<std::mutex> lock(thread_placements_mutex);
+    default_thread_cpus[role] = cpus;
+}
+
+void thread_placement_reset() {
+    std::lock_guard<std::mutex> lock(thread_placements_mutex);
+    thread_placements.clear();
+    default_thread_cpus.clear();
+}
+
+#if defined(__linux__)
+static std::string describe_affinity(const cpu_set_t &set) {
+    std::string out;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) last++;
+        if (!out.empty()) out += ",";
+        out += std::to_string(cpu);
+        if (last != cpu) out += "-" + std::to_string(last);
+        cpu = last;
+    }
+    return out;
+}
+#endif
+
+void thread_placement_apply(const char *role) {
+    ThreadPlacement placement;
+    {
+        std::lock_guard<std::mutex> lock(thread_placements_mutex);
+        auto it = thread_placements.find(role);
+        if (it != thread_placements.end()) placement = it->second;
+        if (placement.cpus.empty()) {
+            auto default_it = default_thread_cpus.find(role);
+            if (default_it != default_thread_cpus.end()) placement.cpus = default_it->second;
+        }
+    }
+
+#if defined(__linux__)
+    pthread_t self = pthread_self();
+
+    // Thread names are limited to 15 characters plus the terminator.
+    std::string name = std::string("dx-") + role;
+    if (name.size() > 15) name.resize(15);
+    pthread_setname_np(self, name.c_str());
+
+    if (!placement.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        int ret = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (ret != 0) {
+            spdlog::warn("[{}] Failed to set CPU affinity: {}", name, strerror(ret));
+        }
+    }
+
+    if (placement.sched_fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = placement.sched_fifo_priority;
+        int ret = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (ret != 0) {
+            spdlog::warn("[{}] Failed to set SCHED_FIFO priority {}: {}", name, placement.sched_fifo_priority, strerror(ret));
+        }
+    }
+
+    // On Linux the nice value is a per-thread attribute addressed by the kernel thread id.
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (placement.set_nice) {
+        if (setpriority(PRIO_PROCESS, tid, placement.nice) != 0) {
+            spdlog::warn("[{}] Failed to set nice value {}: {}", name, placement.nice, strerror(errno));
+        }
+    }
+
+    cpu_set_t effective;
+    CPU_ZERO(&effective);
+    pthread_getaffinity_np(self, sizeof(effective), &effective);
+    int policy = SCHED_OTHER;
+    sched_param param{};
+    pthread_getschedparam(self, &policy, &param);
+    errno = 0;
+    int nice_value = getpriority(PRIO_PROCESS, tid);
+
+    spdlog::info("[{}] tid={} cpus={} policy={} priority={} nice={}", name, tid, describe_affinity(effective),
+                 policy == SCHED_FIFO ? "SCHED_FIFO" : policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER",
+                 param.sched_priority, nice_value);
+#else
+    if (!placement.cpus.empty() || placement.sched_fifo_priority > 0 || placement.set_nice) {
+        spdlog::warn("[dx-{}] Thread placement is not supported on this platform, ignoring", role);
+    }
+#endif
+}
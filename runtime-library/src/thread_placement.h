@@ -0,0 +1,52 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Scheduling and CPU placement requested for one runtime thread role (e.g. "wait").
+ *
+ * Roles are configured through runtime_initialization_with_args() with the keys
+ * "<role>_thread_cpus", "<role>_thread_sched_priority" and "<role>_thread_nice".
+ */
+struct ThreadPlacement {
+    std::vector<int> cpus;          // Allowed CPUs, empty to keep the inherited mask
+    int sched_fifo_priority = 0;    // SCHED_FIFO priority, 0 keeps SCHED_OTHER
+    bool set_nice = false;
+    int nice = 0;
+};
+
+/**
+ * @brief Parses a CPU list such as "0-3,6,8-9".
+ *
+ * @return true if the list is well-formed and every CPU is below CPU_SETSIZE, false otherwise.
+ */
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus);
+
+/**
+ * @brief Consumes an initialization argument if it is a thread placement key.
+ *
+ * @return true if the key was a thread placement key (even if its value was rejected), false otherwise.
+ */
+bool thread_placement_parse_arg(const char *key, const void *value);
+
+/**
+ * @brief Names the calling thread "dx-<role>" and applies the placement configured for the role.
+ *
+ * The effective affinity and scheduling parameters are logged, so the placement actually granted
+ * by the OS (e.g. when SCHED_FIFO is not permitted) is visible at startup.
+ */
+void thread_placement_apply(const char *role);
+
+/**
+ * @brief Sets the CPUs used for a role when no "<role>_thread_cpus" key was given.
+ */
+void thread_placement_set_default_cpus(const char *role, const std::vector<int> &cpus);
+
+/**
+ * @brief Clears all configured placements.
+ */
+void thread_placement_reset();
+
+#endif // THREAD_PLACEMENT_H
@@ -0,0 +1,205 @@
+#include "yolo_postprocess.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YOLO_SSE2 1
+#endif
+
+static inline float sigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
+
+YoloPostprocessor::YoloPostprocessor(const PostprocessOptions &options, YoloFormat format)
+    : options_(options), format_(format) {}
+
+bool YoloPostprocessor::init(const std::vector<PostprocessTensor> &outputs) {
+    output_ = postprocess_find_output(outputs, options_);
+    if (output_ < 0) {
+        spdlog::error("[yolo] Output '{}' not found", options_.output);
+        return false;
+    }
+    const PostprocessTensor &tensor = outputs[output_];
+    const std::vector<int64_t> &shape = tensor.shape;
+    int64_t batch = 1;
+    for (size_t d = 0; d + 2 < shape.size(); d++) {
+        batch *= shape[d];
+    }
+    if (tensor.type != DATA_TYPE_FLOAT || shape.size() < 2 || batch != 1) {
+        spdlog::error("[yolo] Output {} must be a float tensor of shape [1, rows, columns]", tensor.name);
+        return false;
+    }
+
+    size_t rows = static_cast<size_t>(shape[shape.size() - 2]);
+    size_t columns = static_cast<size_t>(shape[shape.size() - 1]);
+    size_t box_fields = format_ == YoloFormat::V5 ? 5 : 4;
+    anchors_ = format_ == YoloFormat::V5 ? rows : columns;
+    size_t fields = format_ == YoloFormat::V5 ? columns : rows;
+    if (fields <= box_fields) {
+        spdlog::error("[yolo] Output {} has no class scores", tensor.name);
+        return false;
+    }
+    classes_ = fields - box_fields;
+
+    float t = std::min(std::max(options_.score_threshold, 1e-6f), 1.0f - 1e-6f);
+    threshold_ = options_.sigmoid ? logf(t / (1.0f - t)) : t;
+    spdlog::info("[yolo] {} anchors, {} classes, score threshold {}, IoU threshold {}", anchors_, classes_,
+                 options_.score_threshold, options_.iou_threshold);
+    return true;
+}
+
+void YoloPostprocessor::filter_v5(const float *data, std::vector<Candidate> &candidates) const {
+    size_t stride = classes_ + 5;
+    for (size_t a = 0; a < anchors_; a++) {
+        const float *row = data + a * stride;
+        // Class scores are at most 1, so the objectness alone must pass the threshold.
+        if (!(row[4] > threshold_)) continue;
+
+        const float *scores = row + 5;
+        size_t best = std::max_element(scores, scores + classes_) - scores;
+        float score = options_.sigmoid ? sigmoid(row[4]) * sigmoid(scores[best]) : row[4] * scores[best];
+        if (score > options_.score_threshold) {
+            candidates.push_back(Candidate{score, static_cast<int>(best), a});
+        }
+    }
+}
+
+void YoloPostprocessor::filter_v8(const float *data, std::vector<Candidate> &candidates) const {
+    const float *scores = data + 4 * anchors_;
+    size_t a = 0;
+#if defined(YOLO_SSE2)
+    // Four anchors at a time: running maximum and argmax over the channel-major class rows.
+    const __m128 threshold = _mm_set1_ps(threshold_);
+    for (; a + 4 <= anchors_; a += 4) {
+        __m128 best = _mm_loadu_ps(scores + a);
+        __m128i best_class = _mm_setzero_si128();
+        for (size_t c = 1; c < classes_; c++) {
+            __m128 value = _mm_loadu_ps(scores + c * anchors_ + a);
+            __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(value, best));
+            best = _mm_max_ps(value, best);
+            best_class = _mm_or_si128(_mm_andnot_si128(greater, best_class),
+                                      _mm_and_si128(greater, _mm_set1_epi32(static_cast<int>(c))));
+        }
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(best, threshold));
+        if (mask == 0) continue;
+
+        float best_scores[4];
+        int32_t best_classes[4];
+        _mm_storeu_ps(best_scores, best);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(best_classes), best_class);
+        for (int k = 0; k < 4; k++) {
+            if (mask & (1 << k)) {
+                float score = options_.sigmoid ? sigmoid(best_scores[k]) : best_scores[k];
+                candidates.push_back(Candidate{score, best_classes[k], a + k});
+            }
+        }
+    }
+#endif
+    for (; a < anchors_; a++) {
+        float best = scores[a];
+        int best_class = 0;
+        for (size_t c = 1; c < classes_; c++) {
+            if (scores[c * anchors_ + a] > best) {
+                best = scores[c * anchors_ + a];
+                best_class = static_cast<int>(c);
+            }
+        }
+        if (best > threshold_) {
+            candidates.push_back(Candidate{options_.sigmoid ? sigmoid(best) : best, best_class, a});
+        }
+    }
+}
+
+void YoloPostprocessor::decode_box(const float *data, size_t anchor, float *box) const {
+    float cx, cy, w, h;
+    if (format_ == YoloFormat::V5) {
+        const float *row = data + anchor * (classes_ + 5);
+        cx = row[0];
+        cy = row[1];
+        w = row[2];
+        h = row[3];
+    } else {
+        cx = data[anchor];
+        cy = data[anchors_ + anchor];
+        w = data[2 * anchors_ + anchor];
+        h = data[3 * anchors_ + anchor];
+    }
+    box[0] = cx - 0.5f * w;
+    box[1] = cy - 0.5f * h;
+    box[2] = cx + 0.5f * w;
+    box[3] = cy + 0.5f * h;
+}
+
+tensors_struct *YoloPostprocessor::run(const std::vector<PostprocessTensor> &outputs) {
+    const float *data = static_cast<const float *>(outputs[output_].data);
+
+    std::vector<Candidate> candidates;
+    if (format_ == YoloFormat::V5) {
+        filter_v5(data, candidates);
+    } else {
+        filter_v8(data, candidates);
+    }
+
+    auto by_score = [](const Candidate &a, const Candidate &b) { return a.score > b.score; };
+    if (candidates.size() > options_.max_candidates) {
+        std::nth_element(candidates.begin(), candidates.begin() + options_.max_candidates, candidates.end(), by_score);
+        candidates.resize(options_.max_candidates);
+    }
+    std::sort(candidates.begin(), candidates.end(), by_score);
+
+    // Boxes are decoded only for the surviving candidates, as structure of arrays for the IoU loop.
+    size_t n = candidates.size();
+    std::vector<float> x1(n), y1(n), x2(n), y2(n), area(n);
+    for (size_t i = 0; i < n; i++) {
+        float box[4];
+        decode_box(data, candidates[i].anchor, box);
+        x1[i] = box[0];
+        y1[i] = box[1];
+        x2[i] = box[2];
+        y2[i] = box[3];
+        area[i] = std::max(box[2] - box[0], 0.0f) * std::max(box[3] - box[1], 0.0f);
+    }
+
+    // Greedy class-aware NMS; suppressed candidates are tracked in a bitmask and never compared again.
+    std::vector<uint64_t> suppressed((n + 63) / 64, 0);
+    std::vector<size_t> kept;
+    const float iou_threshold = options_.iou_threshold;
+    for (size_t i = 0; i < n && kept.size() < options_.max_detections; i++) {
+        if (suppressed[i / 64] & (uint64_t(1) << (i % 64))) continue;
+        kept.push_back(i);
+        for (size_t j = i + 1; j < n; j++) {
+            if (candidates[j].cls != candidates[i].cls) continue;
+            float w = std::min(x2[i], x2[j]) - std::max(x1[i], x1[j]);
+            float h = std::min(y2[i], y2[j]) - std::max(y1[i], y1[j]);
+            float inter = std::max(w, 0.0f) * std::max(h, 0.0f);
+            // inter / union > threshold, without the division
+            if (inter > iou_threshold * (area[i] + area[j] - inter)) {
+                suppressed[j / 64] |= uint64_t(1) << (j % 64);
+            }
+        }
+    }
+
+    tensors_struct *result = postprocess_allocate_result("detections", DATA_TYPE_FLOAT, {kept.size(), 6});
+    if (result == nullptr) {
+        return nullptr;
+    }
+    float *detections = static_cast<float *>(result->data[0]);
+    for (size_t k = 0; k < kept.size(); k++) {
+        size_t i = kept[k];
+        float *detection = detections + k * 6;
+        detection[0] = x1[i];
+        detection[1] = y1[i];
+        detection[2] = x2[i];
+        detection[3] = y2[i];
+        detection[4] = candidates[i].score;
+        detection[5] = static_cast<float>(candidates[i].cls);
+    }
+    return result;
+}
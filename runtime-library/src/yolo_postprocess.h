@@ -0,0 +1,45 @@
+#ifndef YOLO_POSTPROCESS_H
+#define YOLO_POSTPROCESS_H
+
+#include "postprocess.h"
+
+enum class YoloFormat {
+    V5,     // [1, anchors, 5 + classes]: cx, cy, w, h, objectness, class scores
+    V8,     // [1, 4 + classes, anchors]: cx, cy, w, h, class scores, channel-major
+};
+
+/**
+ * @brief Decodes YOLO detection heads and runs class-aware NMS.
+ *
+ * Anchors are filtered on their best score before anything else is decoded; with logit scores the
+ * threshold is moved to the logit domain so the sigmoid is only computed for the survivors. The
+ * candidates are sorted by score and suppressed greedily with a bitmask. The result is a single
+ * "detections" float tensor of shape [count, 6] holding x1, y1, x2, y2, score and class.
+ */
+class YoloPostprocessor : public Postprocessor {
+public:
+    YoloPostprocessor(const PostprocessOptions &options, YoloFormat format);
+
+    bool init(const std::vector<PostprocessTensor> &outputs) override;
+    tensors_struct *run(const std::vector<PostprocessTensor> &outputs) override;
+
+private:
+    struct Candidate {
+        float score;
+        int cls;
+        size_t anchor;
+    };
+
+    void filter_v5(const float *data, std::vector<Candidate> &candidates) const;
+    void filter_v8(const float *data, std::vector<Candidate> &candidates) const;
+    void decode_box(const float *data, size_t anchor, float *box) const;
+
+    PostprocessOptions options_;
+    YoloFormat format_;
+    int output_ = -1;
+    size_t anchors_ = 0;
+    size_t classes_ = 0;
+    float threshold_ = 0.0f;    // Score threshold in the domain of the raw scores
+};
+
+#endif // YOLO_POSTPROCESS_H
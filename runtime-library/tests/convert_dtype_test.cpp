@@ -0,0 +1,339 @@
+#include "tensors_struct.h"
+#include "check.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// Every conversion runs once over the whole array, where the widest vector path takes the bulk and the
+// scalar code the tail, and once per element, which only takes the scalar code. Both are compared bit
+// for bit with references written independently of tensors_struct.c.
+
+static uint32_t bits_of(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float float_of(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static std::vector<float> test_floats(float scale) {
+    std::vector<float> values;
+    // Exact ties in the quantized domain, across and beyond both ranges.
+    for (int k = -300; k <= 300; k++) values.push_back((k + 0.5f) * scale);
+    uint32_t state = 12345;
+    for (int i = 0; i < 1000; i++) {
+        state = state * 1664525u + 1013904223u;
+        values.push_back((static_cast<int>(state >> 8 & 0xffff) - 32768) * scale / 64.0f);
+    }
+    values.push_back(std::numeric_limits<float>::quiet_NaN());
+    values.push_back(-std::numeric_limits<float>::quiet_NaN());
+    values.push_back(std::numeric_limits<float>::infinity());
+    values.push_back(-std::numeric_limits<float>::infinity());
+    values.push_back(1e30f);
+    values.push_back(-1e30f);
+    values.push_back(0.0f);
+    values.push_back(-0.0f);
+    return values;
+}
+
+static void check_conversion(const void *src, tensor_data_type src_type, size_t src_size, tensor_data_type dst_type,
+                             size_t dst_size, size_t count, float scale, int32_t zero_point, const void *expected) {
+    std::vector<unsigned char> whole(count * dst_size + 1);
+    CHECK(convert_tensor_dtype(src, src_type, whole.data(), dst_type, count, scale, zero_point) == 0);
+    CHECK(memcmp(whole.data(), expected, count * dst_size) == 0);
+
+    std::vector<unsigned char> single(count * dst_size + 1);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(convert_tensor_dtype(static_cast<const unsigned char *>(src) + i * src_size, src_type,
+                                   single.data() + i * dst_size, dst_type, 1, scale, zero_point) == 0);
+    }
+    CHECK(memcmp(single.data(), expected, count * dst_size) == 0);
+}
+
+static void test_dequantize() {
+    const float scale = 0.0125f;
+    for (int is_signed = 0; is_signed <= 1; is_signed++) {
+        int32_t zero_point = is_signed ? -7 : 131;
+        std::vector<uint8_t> src;
+        for (int round = 0; round < 3; round++) {
+            for (int q = 0; q < 256; q++) src.push_back(static_cast<uint8_t>(q * 37 + round));
+        }
+        src.resize(src.size() - 5);   // Leaves a tail after the 8- and 16-element blocks
+        std::vector<float> expected;
+        for (uint8_t byte : src) {
+            int32_t q = is_signed ? static_cast<int8_t>(byte) : byte;
+            expected.push_back(static_cast<float>(q - zero_point) * scale);
+        }
+        check_conversion(src.data(), is_signed ? DATA_TYPE_INT8 : DATA_TYPE_UINT8, 1, DATA_TYPE_FLOAT, sizeof(float),
+                         src.size(), scale, zero_point, expected.data());
+    }
+}
+
+static void test_quantize() {
+    const float scales[] = {0.5f, 0.0125f};
+    for (float scale : scales) {
+        std::vector<float> src = test_floats(scale);
+        const float inv_scale = 1.0f / scale;
+        for (int is_signed = 0; is_signed <= 1; is_signed++) {
+            int32_t zero_point = is_signed ? 3 : 10;
+            int32_t low = is_signed ? -128 : 0;
+            int32_t high = is_signed ? 127 : 255;
+            std::vector<uint8_t> expected;
+            for (float x : src) {
+                float v = x * inv_scale;
+                int32_t q;
+                if (isnan(v) || v <= low - zero_point) {
+                    q = low;
+                } else if (v >= high - zero_point) {
+                    q = high;
+                } else {
+                    q = static_cast<int32_t>(nearbyintf(v)) + zero_point;
+                }
+                expected.push_back(static_cast<uint8_t>(q));
+            }
+            check_conversion(src.data(), DATA_TYPE_FLOAT, sizeof(float), is_signed ? DATA_TYPE_INT8 : DATA_TYPE_UINT8,
+                             1, src.size(), scale, zero_point, expected.data());
+        }
+    }
+
+    // Ties go to even, out-of-range values saturate and NaN takes the lowest value.
+    const float values[] = {2.5f, 3.5f, -2.5f, 200.0f, -200.0f, std::numeric_limits<float>::quiet_NaN()};
+    const int8_t expected_int8[] = {2, 4, -2, 127, -128, -128};
+    int8_t int8_out[6];
+    CHECK(convert_tensor_dtype(values, DATA_TYPE_FLOAT, int8_out, DATA_TYPE_INT8, 6, 1.0f, 0) == 0);
+    CHECK(memcmp(int8_out, expected_int8, sizeof(int8_out)) == 0);
+    const uint8_t expected_uint8[] = {12, 14, 8, 210, 0, 0};
+    uint8_t uint8_out[6];
+    CHECK(convert_tensor_dtype(values, DATA_TYPE_FLOAT, uint8_out, DATA_TYPE_UINT8, 6, 1.0f, 10) == 0);
+    CHECK(memcmp(uint8_out, expected_uint8, sizeof(uint8_out)) == 0);
+}
+
+// The value of a half's bit pattern, with infinity as 65536 so that rounding can treat it as the next
+// representable value.
+static double half_value(uint16_t h) {
+    int exponent = h >> 10 & 0x1f;
+    int mantissa = h & 0x3ff;
+    double magnitude = exponent == 0 ? ldexp(mantissa, -24) : ldexp(1024 + mantissa, exponent - 25);
+    return h & 0x8000 ? -magnitude : magnitude;
+}
+
+static uint32_t half_to_float_reference(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    if ((h & 0x7c00) == 0x7c00) {
+        // Infinity, or NaN with its payload kept and made quiet.
+        uint32_t mantissa = static_cast<uint32_t>(h & 0x3ff) << 13;
+        return sign | 0x7f800000 | mantissa | (mantissa != 0 ? 0x00400000 : 0);
+    }
+    return sign | bits_of(static_cast<float>(fabs(half_value(h))));
+}
+
+// Rounds to the nearest half, ties to even, by search over the positive patterns.
+static uint16_t float_to_half_reference(float value) {
+    uint32_t bits = bits_of(value);
+    uint16_t sign = static_cast<uint16_t>(bits >> 16 & 0x8000);
+    if (isnan(value)) return static_cast<uint16_t>(sign | 0x7e00 | (bits >> 13 & 0x3ff));
+    double magnitude = fabs(static_cast<double>(value));
+    uint16_t low = 0;
+    uint16_t high = 0x7c00;
+    if (magnitude >= half_value(high)) return static_cast<uint16_t>(sign | high);
+    while (high - low > 1) {
+        uint16_t middle = static_cast<uint16_t>((low + high) / 2);
+        if (half_value(middle) <= magnitude) low = middle; else high = middle;
+    }
+    double below = magnitude - half_value(low);
+    double above = half_value(high) - magnitude;
+    uint16_t h = below < above || (below == above && (low & 1) == 0) ? low : high;
+    return static_cast<uint16_t>(sign | h);
+}
+
+static double bfloat16_value(uint16_t b) {
+    if ((b & 0x7fff) == 0x7f80) return b & 0x8000 ? -ldexp(1.0, 128) : ldexp(1.0, 128);
+    return float_of(static_cast<uint32_t>(b) << 16);
+}
+
+// Rounds to the nearest bfloat16, ties to even, from the two patterns around the value.
+static uint16_t float_to_bfloat16_reference(float value) {
+    uint32_t bits = bits_of(value);
+    if (isnan(value)) return static_cast<uint16_t>(bits >> 16 | 0x0040);
+    if (isinf(value)) return static_cast<uint16_t>(bits >> 16);
+    uint16_t truncated = static_cast<uint16_t>(bits >> 16);
+    uint16_t next = static_cast<uint16_t>(truncated + 1);
+    double below = fabs(value - bfloat16_value(truncated));
+    double above = fabs(bfloat16_value(next) - value);
+    return below < above || (below == above && (truncated & 1) == 0) ? truncated : next;
+}
+
+static void test_all_halves() {
+    std::vector<uint16_t> halves(65536);
+    for (size_t h = 0; h < halves.size(); h++) halves[h] = static_cast<uint16_t>(h);
+
+    std::vector<uint32_t> expected_floats;
+    for (uint16_t h : halves) expected_floats.push_back(half_to_float_reference(h));
+    check_conversion(halves.data(), DATA_TYPE_FLOAT16, 2, DATA_TYPE_FLOAT, 4, halves.size(), 1.0f, 0,
+                     expected_floats.data());
+
+    // Every half, the midpoints between neighbours and the floats just around them, and NaN payloads.
+    std::vector<float> floats;
+    for (uint32_t bits : expected_floats) floats.push_back(float_of(bits));
+    for (uint16_t h = 0; h < 0x7c00; h++) {
+        float middle = static_cast<float>((half_value(h) + half_value(static_cast<uint16_t>(h + 1))) / 2);
+        floats.push_back(middle);
+        floats.push_back(-middle);
+        floats.push_back(nextafterf(middle, 0.0f));
+        floats.push_back(nextafterf(middle, 1e9f));
+    }
+    const uint32_t nans[] = {0x7fc00000, 0x7f800001, 0x7fffe000, 0xffc00000, 0x7fa00000};
+    for (uint32_t bits : nans) floats.push_back(float_of(bits));
+    floats.push_back(1e-10f);
+    floats.push_back(65520.0f);
+    floats.push_back(1e10f);
+    std::vector<uint16_t> expected_halves;
+    for (float value : floats) expected_halves.push_back(float_to_half_reference(value));
+    check_conversion(floats.data(), DATA_TYPE_FLOAT, 4, DATA_TYPE_FLOAT16, 2, floats.size(), 1.0f, 0,
+                     expected_halves.data());
+}
+
+static void test_bfloat16() {
+    std::vector<uint16_t> patterns(65536);
+    for (size_t b = 0; b < patterns.size(); b++) patterns[b] = static_cast<uint16_t>(b);
+    std::vector<uint32_t> expected_floats;
+    for (uint16_t b : patterns) expected_floats.push_back(static_cast<uint32_t>(b) << 16);
+    check_conversion(patterns.data(), DATA_TYPE_BFLOAT16, 2, DATA_TYPE_FLOAT, 4, patterns.size(), 1.0f, 0,
+                     expected_floats.data());
+
+    std::vector<float> floats;
+    for (uint32_t bits : expected_floats) floats.push_back(float_of(bits));
+    for (uint16_t b = 0; b < 0x7f80; b++) {
+        uint32_t middle = (static_cast<uint32_t>(b) << 16) + 0x8000;
+        floats.push_back(float_of(middle));
+        floats.push_back(float_of(middle | 0x80000000));
+        floats.push_back(float_of(middle - 1));
+        floats.push_back(float_of(middle + 1));
+    }
+    const uint32_t nans[] = {0x7fc00000, 0x7f800001, 0xff812345, 0x7fffffff};
+    for (uint32_t bits : nans) floats.push_back(float_of(bits));
+    std::vector<uint16_t> expected;
+    for (float value : floats) expected.push_back(float_to_bfloat16_reference(value));
+    check_conversion(floats.data(), DATA_TYPE_FLOAT, 4, DATA_TYPE_BFLOAT16, 2, floats.size(), 1.0f, 0,
+                     expected.data());
+}
+
+static void test_half_to_half() {
+    std::vector<uint16_t> patterns(65536);
+    for (size_t p = 0; p < patterns.size(); p++) patterns[p] = static_cast<uint16_t>(p);
+
+    std::vector<uint16_t> expected_bfloat16;
+    std::vector<uint16_t> expected_halves;
+    for (uint16_t p : patterns) {
+        expected_bfloat16.push_back(float_to_bfloat16_reference(float_of(half_to_float_reference(p))));
+        expected_halves.push_back(float_to_half_reference(float_of(static_cast<uint32_t>(p) << 16)));
+    }
+    check_conversion(patterns.data(), DATA_TYPE_FLOAT16, 2, DATA_TYPE_BFLOAT16, 2, patterns.size(), 1.0f, 0,
+                     expected_bfloat16.data());
+    check_conversion(patterns.data(), DATA_TYPE_BFLOAT16, 2, DATA_TYPE_FLOAT16, 2, patterns.size(), 1.0f, 0,
+                     expected_halves.data());
+
+    // Both have the same size, so the conversion may run in place.
+    std::vector<uint16_t> in_place = patterns;
+    CHECK(convert_tensor_dtype(in_place.data(), DATA_TYPE_FLOAT16, in_place.data(), DATA_TYPE_BFLOAT16,
+                               in_place.size(), 1.0f, 0) == 0);
+    CHECK(in_place == expected_bfloat16);
+}
+
+static void test_rejected_buffers() {
+    float floats[64] = {0.0f};
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(floats);
+
+    // Overlapping buffers that do not start at the same address.
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, bytes + 4, DATA_TYPE_INT8, 16, 1.0f, 0) == -1);
+    CHECK(convert_tensor_dtype(bytes + 4, DATA_TYPE_INT8, floats, DATA_TYPE_FLOAT, 16, 1.0f, 0) == -1);
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, bytes + 62, DATA_TYPE_FLOAT16, 32, 1.0f, 0) == -1);
+    // Adjacent buffers do not overlap.
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, floats + 16, DATA_TYPE_FLOAT16, 16, 1.0f, 0) == 0);
+
+    // In place, only conversions that do not widen are accepted.
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_INT8, floats, DATA_TYPE_FLOAT, 16, 1.0f, 0) == -1);
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT16, floats, DATA_TYPE_FLOAT, 16, 1.0f, 0) == -1);
+    for (int i = 0; i < 64; i++) floats[i] = static_cast<float>(i) - 20.5f;
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, floats, DATA_TYPE_INT8, 64, 1.0f, 0) == 0);
+    for (int i = 0; i < 64; i++) {
+        float x = static_cast<float>(i) - 20.5f;
+        CHECK(static_cast<int8_t>(bytes[i]) == static_cast<int8_t>(nearbyintf(x)));
+    }
+
+    // Unsupported types and invalid quantization scales.
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_INT32, bytes, DATA_TYPE_FLOAT, 1, 1.0f, 0) == -1);
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, bytes + 128, DATA_TYPE_INT8, 1, 0.0f, 0) == -1);
+    CHECK(convert_tensor_dtype(floats, DATA_TYPE_FLOAT, bytes + 128, DATA_TYPE_UINT8, 1,
+                               std::numeric_limits<float>::quiet_NaN(), 0) == -1);
+}
+
+// Half-precision outputs as the runtime returns them: converted from the device's float buffer into
+// a tensors_struct, which is then copied and compared like any other.
+static void test_half_precision_outputs() {
+    const size_t count = 1000;
+    std::vector<float> device(count);
+    for (size_t i = 0; i < count; i++) device[i] = sinf(static_cast<float>(i) * 0.37f) * static_cast<float>(i);
+
+    const tensor_data_type types[] = {DATA_TYPE_FLOAT16, DATA_TYPE_BFLOAT16};
+    tensors_struct *outputs = allocate_tensors_struct(2);
+    CHECK(outputs != nullptr);
+    for (size_t t = 0; t < 2; t++) {
+        CHECK(get_data_type_byte_size(types[t]) == 2);
+        outputs->names[t] = tensors_strdup(t == 0 ? "logits_f16" : "logits_bf16");
+        outputs->data_types[t] = types[t];
+        outputs->ranks[t] = 2;
+        outputs->shapes[t] = static_cast<size_t *>(tensors_malloc(2 * sizeof(size_t)));
+        outputs->shapes[t][0] = 4;
+        outputs->shapes[t][1] = count / 4;
+        outputs->data[t] = tensors_malloc(count * get_data_type_byte_size(types[t]));
+        CHECK(convert_tensor_dtype(device.data(), DATA_TYPE_FLOAT, outputs->data[t], types[t], count, 1.0f, 0) == 0);
+    }
+
+    // The copy and the comparison cover every byte of the half-precision data.
+    tensors_struct *copy = deep_copy_tensors_struct(outputs);
+    CHECK(copy != nullptr);
+    CHECK(compare_two_tensors_structs(outputs, copy));
+    for (size_t t = 0; t < 2; t++) {
+        uint16_t *last = static_cast<uint16_t *>(copy->data[t]) + count - 1;
+        *last ^= 1;
+        CHECK(!compare_two_tensors_structs(outputs, copy));
+        *last ^= 1;
+    }
+
+    // Back to float, each value is within half a unit in the last place of the type, and converting
+    // again gives the same bits.
+    const float epsilons[] = {1.0f / 2048, 1.0f / 256};
+    for (size_t t = 0; t < 2; t++) {
+        std::vector<float> restored(count);
+        CHECK(convert_tensor_dtype(copy->data[t], types[t], restored.data(), DATA_TYPE_FLOAT, count, 1.0f, 0) == 0);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(fabsf(restored[i] - device[i]) <= fabsf(device[i]) * epsilons[t]);
+        }
+        std::vector<uint16_t> again(count);
+        CHECK(convert_tensor_dtype(restored.data(), DATA_TYPE_FLOAT, again.data(), types[t], count, 1.0f, 0) == 0);
+        CHECK(memcmp(again.data(), copy->data[t], count * sizeof(uint16_t)) == 0);
+    }
+    deep_free_tensors_struct(copy);
+    deep_free_tensors_struct(outputs);
+}
+
+int main() {
+    test_dequantize();
+    test_quantize();
+    test_all_halves();
+    test_bfloat16();
+    test_half_to_half();
+    test_rejected_buffers();
+    test_half_precision_outputs();
+    return 0;
+}
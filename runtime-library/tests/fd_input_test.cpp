@@ -0,0 +1,113 @@
+#include "fd_input.h"
+#include "check.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+static std::vector<unsigned char> pattern(size_t size, unsigned char seed) {
+    std::vector<unsigned char> bytes(size);
+    for (size_t i = 0; i < size; i++) bytes[i] = static_cast<unsigned char>(seed + i * 7);
+    return bytes;
+}
+
+static int make_memfd(const std::vector<unsigned char> &bytes) {
+    int fd = memfd_create("fd_input_test", MFD_CLOEXEC);
+    CHECK(fd >= 0);
+    CHECK(pwrite(fd, bytes.data(), bytes.size(), 0) == static_cast<ssize_t>(bytes.size()));
+    return fd;
+}
+
+static void test_bytes_reach_the_input() {
+    std::vector<unsigned char> bytes = pattern(8192, 3);
+    int fd = make_memfd(bytes);
+
+    FdInputMapping mapping;
+    CHECK(fd_input_acquire(fd, 100, 4000, mapping));
+    CHECK(mapping.data != nullptr && mapping.entry != nullptr);
+    CHECK(memcmp(mapping.data, bytes.data() + 100, 4000) == 0);
+
+    // The cache keeps its own duplicate, so the caller may close the fd while the input is in use.
+    close(fd);
+    CHECK(memcmp(mapping.data, bytes.data() + 100, 4000) == 0);
+    fd_input_release(mapping);
+    CHECK(mapping.data == nullptr && mapping.entry == nullptr);
+}
+
+static void test_recycled_buffer_is_mapped_once() {
+    std::vector<unsigned char> bytes = pattern(4096, 11);
+    int fd = make_memfd(bytes);
+    int other_fd = dup(fd);
+
+    FdInputMapping first;
+    CHECK(fd_input_acquire(fd, 0, 4096, first));
+    FdInputEntry *cached = first.entry;
+    fd_input_release(first);
+
+    // A decoder writing the next frame into the same buffer, submitted through another fd number.
+    std::vector<unsigned char> next = pattern(4096, 29);
+    CHECK(pwrite(fd, next.data(), next.size(), 0) == 4096);
+    FdInputMapping second;
+    CHECK(fd_input_acquire(other_fd, 0, 4096, second));
+    CHECK(second.entry == cached);
+    CHECK(memcmp(second.data, next.data(), 4096) == 0);
+    fd_input_release(second);
+
+    close(other_fd);
+    close(fd);
+}
+
+static void test_larger_range_keeps_smaller_mapping_valid() {
+    std::vector<unsigned char> bytes = pattern(3 * 4096, 5);
+    int fd = make_memfd(bytes);
+
+    FdInputMapping small;
+    CHECK(fd_input_acquire(fd, 0, 4096, small));
+    FdInputMapping large;
+    CHECK(fd_input_acquire(fd, 4096, 2 * 4096, large));
+    CHECK(large.entry != small.entry);
+    CHECK(memcmp(small.data, bytes.data(), 4096) == 0);
+    CHECK(memcmp(large.data, bytes.data() + 4096, 2 * 4096) == 0);
+    fd_input_release(small);
+    fd_input_release(large);
+    close(fd);
+}
+
+static void test_invalid_inputs() {
+    std::vector<unsigned char> bytes = pattern(4096, 1);
+    int fd = make_memfd(bytes);
+
+    FdInputMapping mapping;
+    CHECK(!fd_input_acquire(fd, 1, 4096, mapping));
+    CHECK(mapping.data == nullptr);
+    close(fd);
+    CHECK(!fd_input_acquire(fd, 0, 16, mapping));
+}
+
+static void test_reset_keeps_inputs_in_use() {
+    std::vector<unsigned char> bytes = pattern(4096, 17);
+    int fd = make_memfd(bytes);
+
+    FdInputMapping mapping;
+    CHECK(fd_input_acquire(fd, 0, 4096, mapping));
+    close(fd);
+    fd_input_set_cache_size(0);
+    fd_input_reset();
+    CHECK(memcmp(mapping.data, bytes.data(), 4096) == 0);
+    fd_input_release(mapping);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_bytes_reach_the_input();
+    test_recycled_buffer_is_mapped_once();
+    test_larger_range_keeps_smaller_mapping_valid();
+    test_invalid_inputs();
+    test_reset_keeps_inputs_in_use();
+    fd_input_reset();
+    return 0;
+}
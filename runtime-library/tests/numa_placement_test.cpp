@@ -0,0 +1,117 @@
+#include "numa_placement.h"
+#include "check.h"
+
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <spdlog/spdlog.h>
+
+static std::string make_dir(const std::string &path) {
+    std::string partial;
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = path.find('/', pos + 1);
+        partial = path.substr(0, pos);
+        mkdir(partial.c_str(), 0755);
+    }
+    return path;
+}
+
+static void write_file(const std::string &path, const std::string &text) {
+    std::ofstream f(path);
+    f << text << "\n";
+}
+
+// Two devices on node 1 and one on node 0, as the DX-RT driver would expose them.
+static std::string make_fake_sysfs() {
+    char root_template[] = "/tmp/numa_placement_test_XXXXXX";
+    std::string root = mkdtemp(root_template);
+    const int device_nodes[] = {1, 1, 0};
+    for (int device = 0; device < 3; device++) {
+        std::string dir = make_dir(root + "/class/dxrt/dxrt" + std::to_string(device) + "/device");
+        write_file(dir + "/numa_node", std::to_string(device_nodes[device]));
+    }
+    write_file(make_dir(root + "/devices/system/node/node0") + "/cpulist", "0-1");
+    write_file(make_dir(root + "/devices/system/node/node1") + "/cpulist", "2-3,6");
+    return root;
+}
+
+static void test_sysfs_topology(const std::string &root) {
+    numa_placement_reset();
+    CHECK(numa_placement_parse_arg("numa_sysfs_root", root.c_str()));
+    numa_placement_init(4);
+
+    CHECK(numa_node_of_device(0) == 1);
+    CHECK(numa_node_of_device(1) == 1);
+    CHECK(numa_node_of_device(2) == 0);
+    CHECK(numa_node_of_device(3) == -1);    // No sysfs entry
+    CHECK(numa_node_of_device(4) == -1);    // Out of range
+
+    std::vector<int> nodes = numa_device_nodes();
+    CHECK(nodes.size() == 2);
+    CHECK(nodes[0] == 1 && nodes[1] == 0);
+
+    std::vector<int> cpus = numa_node_cpus(1);
+    CHECK(cpus.size() == 3);
+    CHECK(cpus[0] == 2 && cpus[1] == 3 && cpus[2] == 6);
+    CHECK(numa_node_cpus(0).size() == 2);
+    CHECK(numa_node_cpus(5).empty());
+    CHECK(numa_node_cpus(-1).empty());
+}
+
+static void test_topology_overrides_sysfs(const std::string &root) {
+    numa_placement_reset();
+    numa_placement_parse_arg("numa_sysfs_root", root.c_str());
+    numa_placement_parse_arg("numa_topology", "0:0,2:1");
+    numa_placement_init(3);
+
+    CHECK(numa_node_of_device(0) == 0);
+    CHECK(numa_node_of_device(1) == -1);
+    CHECK(numa_node_of_device(2) == 1);
+    // The CPUs of a node still come from the sysfs root.
+    CHECK(numa_node_cpus(1).size() == 3);
+}
+
+static void test_disabled(const std::string &root) {
+    numa_placement_reset();
+    numa_placement_parse_arg("numa_sysfs_root", root.c_str());
+    int enable = 0;
+    numa_placement_parse_arg("numa_enable", &enable);
+    numa_placement_init(3);
+
+    CHECK(numa_node_of_device(0) == -1);
+    CHECK(numa_device_nodes().empty());
+}
+
+// Without numa_placement_init() libnuma is not loaded, so the fake nodes are only accounted.
+static void test_allocation_stats() {
+    numa_placement_reset();
+
+    static char buffer[8192];
+    CHECK(!numa_bind_memory(buffer, 4096, 1));
+    CHECK(!numa_bind_memory(buffer + 4096, 4096, 0));
+    std::string stats = numa_stats_json();
+    CHECK(stats.find("{\"node\":0,\"ranges\":1,\"bytes\":4096,\"unbound_bytes\":4096}") != std::string::npos);
+    CHECK(stats.find("{\"node\":1,\"ranges\":1,\"bytes\":4096,\"unbound_bytes\":4096}") != std::string::npos);
+
+    numa_release_memory(buffer);
+    numa_release_memory(buffer + 4096);
+    stats = numa_stats_json();
+    CHECK(stats.find("\"ranges\":1") == std::string::npos);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::warn);
+    std::string root = make_fake_sysfs();
+    test_sysfs_topology(root);
+    test_topology_overrides_sysfs(root);
+    test_disabled(root);
+    test_allocation_stats();
+    numa_placement_reset();
+
+    std::string command = "rm -rf " + root;
+    CHECK(system(command.c_str()) == 0);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "output_layout.h"
+#include "check.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+// A device buffer of the shape with rows padded to row_stride elements. Every element has distinct bytes
+// and the padding holds a marker that must never reach the output.
+static std::vector<uint8_t> device_buffer(const std::vector<int64_t> &shape, size_t elem_size, size_t row_stride) {
+    size_t rows = 1;
+    for (size_t d = 0; d + 1 < shape.size(); d++) rows *= static_cast<size_t>(shape[d]);
+    size_t row_elems = static_cast<size_t>(shape.back());
+    std::vector<uint8_t> buffer(rows * row_stride * elem_size, 0xee);
+    uint32_t value = 1;
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t e = 0; e < row_elems; e++) {
+            uint8_t *element = buffer.data() + (r * row_stride + e) * elem_size;
+            for (size_t b = 0; b < elem_size; b++) {
+                value = value * 1664525u + 1013904223u;
+                element[b] = static_cast<uint8_t>(value >> 24 == 0xee ? 0 : value >> 24);
+            }
+        }
+    }
+    return buffer;
+}
+
+// The logical output by plain index mapping, element by element.
+static std::vector<uint8_t> reference_unpack(const std::vector<uint8_t> &src, const std::vector<int64_t> &shape,
+                                             size_t elem_size, size_t row_stride, LayoutConversion conversion) {
+    std::vector<uint8_t> dst(src.size() / row_stride * static_cast<size_t>(shape.back()));
+    size_t at = 0;
+    auto put = [&](size_t src_element) {
+        memcpy(dst.data() + at * elem_size, src.data() + src_element * elem_size, elem_size);
+        at++;
+    };
+    if (shape.size() == 4 && conversion == LayoutConversion::NHWC_TO_NCHW) {
+        size_t n = shape[0], h = shape[1], w = shape[2], c = shape[3];
+        for (size_t b = 0; b < n; b++)
+            for (size_t k = 0; k < c; k++)
+                for (size_t y = 0; y < h; y++)
+                    for (size_t x = 0; x < w; x++) put(((b * h + y) * w + x) * row_stride + k);
+    } else if (shape.size() == 4 && conversion == LayoutConversion::NCHW_TO_NHWC) {
+        size_t n = shape[0], c = shape[1], h = shape[2], w = shape[3];
+        for (size_t b = 0; b < n; b++)
+            for (size_t y = 0; y < h; y++)
+                for (size_t x = 0; x < w; x++)
+                    for (size_t k = 0; k < c; k++) put(((b * c + k) * h + y) * row_stride + x);
+    } else {
+        size_t row_elems = static_cast<size_t>(shape.back());
+        for (size_t r = 0; r < src.size() / elem_size / row_stride; r++)
+            for (size_t e = 0; e < row_elems; e++) put(r * row_stride + e);
+    }
+    return dst;
+}
+
+static void check_unpack(const std::vector<int64_t> &shape, size_t elem_size, size_t row_stride,
+                         LayoutConversion conversion) {
+    std::vector<uint8_t> src = device_buffer(shape, elem_size, row_stride);
+    OutputLayout layout;
+    bool needed = output_layout_init(shape, elem_size, src.size(), conversion, layout);
+    bool transposed = shape.size() == 4 && conversion != LayoutConversion::NONE &&
+                      (elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8);
+    CHECK(needed == (transposed || row_stride != static_cast<size_t>(shape.back())));
+    CHECK(layout.conversion == (transposed ? conversion : LayoutConversion::NONE));
+    if (!needed) return;
+    CHECK(layout.row_stride == row_stride);
+
+    std::vector<uint8_t> expected =
+        reference_unpack(src, shape, elem_size, row_stride, transposed ? conversion : LayoutConversion::NONE);
+    std::vector<uint8_t> dst(expected.size(), 0xee);
+    output_layout_unpack(src.data(), dst.data(), layout);
+    CHECK(dst == expected);
+}
+
+static void test_strip_padding() {
+    const size_t elem_sizes[] = {1, 2, 3, 4, 8};
+    for (size_t elem_size : elem_sizes) {
+        check_unpack({3, 5, 7}, elem_size, 16, LayoutConversion::NONE);
+        check_unpack({130}, elem_size, 192, LayoutConversion::NONE);
+        check_unpack({3, 5, 16}, elem_size, 16, LayoutConversion::NONE);    // No padding, copied as is
+        // Rank 4 outputs of a size without a transpose are only stripped.
+        check_unpack({1, 2, 3, 5}, elem_size, 8, LayoutConversion::NHWC_TO_NCHW);
+    }
+}
+
+static void test_transposes() {
+    const size_t elem_sizes[] = {1, 2, 4, 8};
+    for (size_t elem_size : elem_sizes) {
+        // H * W = 135 and C = 70 leave partial tiles on both sides, with and without padded rows.
+        check_unpack({2, 9, 15, 70}, elem_size, 70, LayoutConversion::NHWC_TO_NCHW);
+        check_unpack({2, 9, 15, 70}, elem_size, 80, LayoutConversion::NHWC_TO_NCHW);
+        check_unpack({1, 8, 8, 64}, elem_size, 64, LayoutConversion::NHWC_TO_NCHW);
+        check_unpack({1, 1, 1, 3}, elem_size, 16, LayoutConversion::NHWC_TO_NCHW);
+        // C = 70 and W = 131 likewise for the opposite direction.
+        check_unpack({2, 70, 3, 131}, elem_size, 131, LayoutConversion::NCHW_TO_NHWC);
+        check_unpack({2, 70, 3, 131}, elem_size, 136, LayoutConversion::NCHW_TO_NHWC);
+        check_unpack({1, 65, 2, 64}, elem_size, 64, LayoutConversion::NCHW_TO_NHWC);
+        // Other ranks are never transposed.
+        check_unpack({4, 9, 70}, elem_size, 80, LayoutConversion::NCHW_TO_NHWC);
+    }
+}
+
+static void test_init_and_shape() {
+    OutputLayout layout;
+    // A device buffer that does not hold whole rows, or holds less than the shape, is copied as is.
+    CHECK(!output_layout_init({3, 5}, 4, 3 * 5 * 4 + 4, LayoutConversion::NONE, layout));
+    CHECK(!output_layout_init({3, 5}, 4, 3 * 4 * 4, LayoutConversion::NONE, layout));
+    CHECK(!output_layout_init({3, 0}, 4, 0, LayoutConversion::NONE, layout));
+    CHECK(!output_layout_init({}, 4, 16, LayoutConversion::NONE, layout));
+
+    std::vector<int64_t> shape = {2, 9, 15, 70};
+    CHECK(output_layout_init(shape, 4, 2 * 9 * 15 * 80 * 4, LayoutConversion::NHWC_TO_NCHW, layout));
+    output_layout_shape(layout, shape);
+    CHECK((shape == std::vector<int64_t>{2, 70, 9, 15}));
+    shape = {2, 70, 3, 131};
+    CHECK(output_layout_init(shape, 2, 2 * 70 * 3 * 131 * 2, LayoutConversion::NCHW_TO_NHWC, layout));
+    output_layout_shape(layout, shape);
+    CHECK((shape == std::vector<int64_t>{2, 3, 131, 70}));
+    shape = {3, 5, 7};
+    CHECK(output_layout_init(shape, 4, 3 * 5 * 8 * 4, LayoutConversion::NCHW_TO_NHWC, layout));
+    output_layout_shape(layout, shape);
+    CHECK((shape == std::vector<int64_t>{3, 5, 7}));
+
+    LayoutConversion conversion = LayoutConversion::NONE;
+    CHECK(output_layout_parse("nchw", conversion) && conversion == LayoutConversion::NHWC_TO_NCHW);
+    CHECK(output_layout_parse("nhwc", conversion) && conversion == LayoutConversion::NCHW_TO_NHWC);
+    CHECK(output_layout_parse("native", conversion) && conversion == LayoutConversion::NONE);
+    CHECK(!output_layout_parse("chw", conversion));
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_strip_padding();
+    test_transposes();
+    test_init_and_shape();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "output_pool.h"
+#include "check.h"
+
+extern "C" {
+#include "tensors_struct.h"
+}
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+static const size_t SLOT = 4096;
+
+static bool has_stat(const OutputPool &pool, const std::string &stat) {
+    return pool.stats_json().find(stat) != std::string::npos;
+}
+
+// Blocks in acquire() on another thread until main releases a slot.
+static void acquire_after_release(OutputPool &pool, void *slot) {
+    void *acquired = nullptr;
+    std::thread waiter([&pool, &acquired]() { acquired = pool.acquire(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(acquired == nullptr);
+    pool.release(slot);
+    waiter.join();
+    CHECK(acquired == slot);
+}
+
+static void test_budget_smaller_than_a_slot() {
+    OutputPool pool;
+    OutputPoolOptions options;
+    options.min_slots = 2;
+    options.max_bytes = SLOT / 2;
+    CHECK(!pool.init(SLOT, {-1}, options));
+    CHECK(pool.capacity() == 0);
+}
+
+static void test_budget_trims_min_slots() {
+    OutputPool pool;
+    OutputPoolOptions options;
+    options.min_slots = 4;
+    options.max_bytes = 3 * SLOT;
+    CHECK(pool.init(SLOT, {-1}, options));
+    CHECK(pool.capacity() == 3);
+    CHECK(has_stat(pool, "\"min_slots\":3"));
+    CHECK(has_stat(pool, "\"bytes\":12288"));
+}
+
+static void test_growth_and_shrink() {
+    OutputPool pool;
+    OutputPoolOptions options;
+    options.min_slots = 2;
+    options.max_slots = 4;
+    options.grow_slots = 1;
+    options.shrink_idle_ms = 200;
+    CHECK(pool.init(SLOT, {-1}, options));
+    CHECK(pool.capacity() == 2);
+
+    void *slots[4];
+    for (int i = 0; i < 4; i++) {
+        slots[i] = pool.acquire();
+        CHECK(slots[i] != nullptr);
+    }
+    CHECK(pool.capacity() == 4);
+    CHECK(pool.available() == 0);
+    CHECK(has_stat(pool, "\"grow_events\":2"));
+    CHECK(has_stat(pool, "\"high_water_bytes\":16384"));
+
+    // At max_slots the pool waits for a release instead of growing.
+    acquire_after_release(pool, slots[3]);
+    CHECK(has_stat(pool, "\"starvation_waits\":1"));
+    CHECK(pool.capacity() == 4);
+
+    // Grown slabs are released once entirely free and idle, down to min_slots.
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    for (int i = 3; i >= 0; i--) pool.release(slots[i]);
+    CHECK(pool.capacity() == 2);
+    CHECK(pool.available() == 2);
+    CHECK(has_stat(pool, "\"shrink_events\":2"));
+    CHECK(has_stat(pool, "\"bytes\":8192"));
+}
+
+static void test_budget_refuses_growth() {
+    OutputPool pool;
+    OutputPoolOptions options;
+    options.min_slots = 1;
+    options.max_slots = 8;
+    options.grow_slots = 1;
+    options.max_bytes = 2 * SLOT;
+    CHECK(pool.init(SLOT, {-1}, options));
+
+    void *first = pool.acquire();
+    void *second = pool.acquire();
+    CHECK(first != nullptr && second != nullptr);
+    CHECK(pool.capacity() == 2);
+
+    acquire_after_release(pool, first);
+    CHECK(pool.capacity() == 2);
+    CHECK(has_stat(pool, "\"budget_refusals\":1"));
+    CHECK(has_stat(pool, "\"grow_failures\":0"));
+    pool.release(first);
+    pool.release(second);
+}
+
+// A host allocator that runs out of memory after its first allocation.
+static int host_allocations = 0;
+static void *limited_alloc(size_t size, void *) {
+    return host_allocations++ < 1 ? malloc(size) : nullptr;
+}
+static void *limited_aligned_alloc(size_t alignment, size_t size, void *) {
+    void *ptr = nullptr;
+    if (host_allocations++ >= 1 || posix_memalign(&ptr, alignment, size) != 0) return nullptr;
+    return ptr;
+}
+static void limited_free(void *ptr, void *) {
+    free(ptr);
+}
+
+static void test_failed_growth_waits() {
+    tensors_allocator allocator = {limited_alloc, limited_aligned_alloc, limited_free, nullptr};
+    CHECK(set_tensors_allocator(&allocator) == 0);
+    host_allocations = 0;
+    {
+        OutputPool pool;
+        OutputPoolOptions options;
+        options.min_slots = 1;
+        options.max_slots = 4;
+        options.grow_slots = 1;
+        CHECK(pool.init(SLOT, {-1}, options));
+
+        void *slot = pool.acquire();
+        CHECK(slot != nullptr);
+        acquire_after_release(pool, slot);
+        CHECK(pool.capacity() == 1);
+        CHECK(has_stat(pool, "\"grow_failures\":1"));
+        CHECK(has_stat(pool, "\"starvation_waits\":1"));
+        pool.release(slot);
+    }
+    set_tensors_allocator(nullptr);
+}
+
+static void test_shutdown_wakes_acquire() {
+    OutputPool pool;
+    OutputPoolOptions options;
+    options.min_slots = 1;
+    CHECK(pool.init(SLOT, {-1}, options));
+    void *slot = pool.acquire();
+    CHECK(slot != nullptr);
+
+    void *acquired = slot;
+    std::thread waiter([&pool, &acquired]() { acquired = pool.acquire(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pool.shutdown();
+    waiter.join();
+    CHECK(acquired == nullptr);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_budget_smaller_than_a_slot();
+    test_budget_trims_min_slots();
+    test_growth_and_shrink();
+    test_budget_refuses_growth();
+    test_failed_growth_waits();
+    test_shutdown_wakes_acquire();
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "pipeline.h"
+#include "check.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+static const size_t ITEMS = 200;
+
+static size_t slots[ITEMS];
+
+static void *item(size_t index) {
+    slots[index] = index;
+    return &slots[index];
+}
+
+static size_t index_of(void *item) {
+    return *static_cast<size_t *>(item);
+}
+
+// Every value of the key in a stats JSON object, e.g. the high water mark of each stage.
+static std::vector<size_t> json_values(const std::string &json, const std::string &key) {
+    std::vector<size_t> values;
+    std::string pattern = "\"" + key + "\":";
+    for (size_t at = json.find(pattern); at != std::string::npos; at = json.find(pattern, at + 1)) {
+        values.push_back(static_cast<size_t>(strtoull(json.c_str() + at + pattern.size(), nullptr, 10)));
+    }
+    return values;
+}
+
+// Lets the threads blocked in wait() through once opened.
+class Gate {
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return open_; });
+    }
+
+    void open() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_ = false;
+};
+
+static void test_order_with_random_delays() {
+    const char *names[] = {"decode", "infer", "encode"};
+    const size_t capacity = 4;
+    std::atomic<int> progress[ITEMS];
+    for (auto &stage : progress) stage = 0;
+    std::atomic<bool> overtaken(false);
+    std::atomic<size_t> last_decoded(0);
+
+    Pipeline pipeline;
+    for (int s = 0; s < 3; s++) {
+        pipeline.add_stage(names[s], [&, s](void *item) {
+            size_t index = index_of(item);
+            // Each item leaves the previous stage before it enters this one.
+            CHECK(progress[index].load() == s);
+            unsigned seed = static_cast<unsigned>(index * 3 + s);
+            std::this_thread::sleep_for(std::chrono::microseconds(rand_r(&seed) % 2000));
+            if (s == 0) {
+                if (index % 3 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(3));
+                if (index < last_decoded.load()) overtaken = true;
+                last_decoded = std::max(last_decoded.load(), index);
+            }
+            progress[index] = s + 1;
+        });
+    }
+
+    std::mutex sink_mutex;
+    std::condition_variable sink_cv;
+    std::vector<size_t> received;
+    PipelineOptions options;
+    options.threads = 4;
+    options.capacity = capacity;
+    options.workers = {{"decode", 3}, {"infer", 2}, {"encode", 3}};
+    CHECK(pipeline.start(options, [&](void *item) {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        CHECK(progress[index_of(item)].load() == 3);
+        received.push_back(index_of(item));
+        sink_cv.notify_all();
+    }));
+    for (size_t i = 0; i < ITEMS; i++) pipeline.submit(item(i));
+    {
+        std::unique_lock<std::mutex> lock(sink_mutex);
+        sink_cv.wait(lock, [&]() { return received.size() == ITEMS; });
+    }
+
+    // Items finished the multi-worker stage out of order and still reached the sink in order, and no stage
+    // ever held more than its capacity, counting the items started upstream and bound for it.
+    CHECK(overtaken.load());
+    for (size_t i = 0; i < ITEMS; i++) CHECK(received[i] == i);
+    std::string stats = pipeline.stats_json();
+    std::vector<size_t> high_water = json_values(stats, "high_water");
+    CHECK(high_water.size() == 3);
+    for (size_t water : high_water) CHECK(water >= 1 && water <= capacity);
+    for (size_t processed : json_values(stats, "processed")) CHECK(processed == ITEMS);
+    pipeline.stop();
+    CHECK(!pipeline.running());
+}
+
+static void test_submit_blocks_at_capacity() {
+    Gate gate;
+    Pipeline pipeline;
+    pipeline.add_stage("fast", [](void *) {});
+    pipeline.add_stage("slow", [&gate](void *) { gate.wait(); });
+
+    std::mutex sink_mutex;
+    std::vector<size_t> received;
+    PipelineOptions options;
+    options.threads = 2;
+    options.capacity = 2;
+    CHECK(pipeline.start(options, [&](void *item) {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        received.push_back(index_of(item));
+    }));
+
+    // The slow stage holds one item running and one queued, then the fast stage fills up with two queued
+    // items, and the fifth submission waits.
+    std::atomic<size_t> submitted(0);
+    std::thread submitter([&]() {
+        for (size_t i = 0; i < 8; i++) {
+            pipeline.submit(item(i));
+            submitted++;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(submitted.load() == 4);
+    std::vector<size_t> occupancy = json_values(pipeline.stats_json(), "occupancy");
+    CHECK(occupancy.size() == 2 && occupancy[0] == 2 && occupancy[1] == 2);
+
+    gate.open();
+    submitter.join();
+    // stop() returns once every submitted item reached the sink.
+    pipeline.stop();
+    CHECK(received.size() == 8);
+    for (size_t i = 0; i < 8; i++) CHECK(received[i] == i);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_order_with_random_delays();
+    test_submit_blocks_at_capacity();
+    return 0;
+}
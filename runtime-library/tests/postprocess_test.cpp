@@ -0,0 +1,339 @@
+#include "postprocess.h"
+#include "check.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+static bool near(float a, float b) {
+    return fabsf(a - b) <= 1e-6f * std::max(1.0f, fabsf(b));
+}
+
+static float sigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
+
+// Initializes the stage on the output's description, as model loading does, and runs it on the data.
+static tensors_struct *run_stage(const PostprocessOptions &options, const char *name, const std::vector<int64_t> &shape,
+                                 const std::vector<float> &data) {
+    std::unique_ptr<Postprocessor> stage = postprocess_create(options);
+    CHECK(stage != nullptr);
+    PostprocessTensor tensor;
+    tensor.name = name;
+    tensor.shape = shape;
+    tensor.type = DATA_TYPE_FLOAT;
+    CHECK(stage->init({tensor}));
+    tensor.data = data.data();
+    tensors_struct *result = stage->run({tensor});
+    CHECK(result != nullptr);
+    return result;
+}
+
+// A YOLOv8 head is channel-major: the box fields, then one row per class, each holding every anchor.
+static void set_v8_anchor(std::vector<float> &data, size_t anchors, size_t anchor, float cx, float cy, float w, float h,
+                          const std::vector<float> &scores) {
+    const float box[] = {cx, cy, w, h};
+    for (size_t f = 0; f < 4; f++) data[f * anchors + anchor] = box[f];
+    for (size_t c = 0; c < scores.size(); c++) data[(4 + c) * anchors + anchor] = scores[c];
+}
+
+// A YOLOv5 head is anchor-major: box fields, objectness and class scores per anchor.
+static void set_v5_anchor(std::vector<float> &data, size_t classes, size_t anchor, float cx, float cy, float w,
+                          float h, float objectness, const std::vector<float> &scores) {
+    float *row = data.data() + anchor * (5 + classes);
+    const float fields[] = {cx, cy, w, h, objectness};
+    std::copy(fields, fields + 5, row);
+    std::copy(scores.begin(), scores.end(), row + 5);
+}
+
+static size_t detection_count(const tensors_struct *result) {
+    CHECK(result->num_tensors == 1 && result->ranks[0] == 2 && result->shapes[0][1] == 6);
+    return result->shapes[0][0];
+}
+
+static void check_detection(const tensors_struct *result, size_t k, float cx, float cy, float w, float h, float score,
+                            int cls) {
+    const float *detection = static_cast<const float *>(result->data[0]) + k * 6;
+    CHECK(detection[0] == cx - 0.5f * w && detection[1] == cy - 0.5f * h);
+    CHECK(detection[2] == cx + 0.5f * w && detection[3] == cy + 0.5f * h);
+    CHECK(near(detection[4], score));
+    CHECK(detection[5] == static_cast<float>(cls));
+}
+
+static void test_yolov8_threshold_and_ties() {
+    // Nine anchors: two blocks of four for the vector argmax and one for the scalar tail.
+    const size_t anchors = 9;
+    std::vector<float> data((4 + 3) * anchors, 0.0f);
+    const std::vector<std::vector<float>> scores = {
+        {0.9f, 0.1f, 0.1f},  {0.5f, 0.5f, 0.5f}, {0.2f, 0.7f, 0.7f}, {0.6f, 0.6f, 0.6f}, {0.1f, 0.2f, 0.3f},
+        {0.3f, 0.8f, 0.8f},  {0.51f, 0.4f, 0.4f}, {0.1f, 0.1f, 0.1f}, {0.4f, 0.95f, 0.95f},
+    };
+    for (size_t a = 0; a < anchors; a++) set_v8_anchor(data, anchors, a, 10.0f * a + 5.0f, 5.0f, 8.0f, 8.0f, scores[a]);
+
+    PostprocessOptions options;
+    options.stage = "yolov8";
+    options.score_threshold = 0.5f;
+    tensors_struct *result = run_stage(options, "output0", {1, 7, static_cast<int64_t>(anchors)}, data);
+    // Scores equal to the threshold are dropped, and ties go to the lowest class.
+    CHECK(detection_count(result) == 6);
+    check_detection(result, 0, 85.0f, 5.0f, 8.0f, 8.0f, 0.95f, 1);
+    check_detection(result, 1, 5.0f, 5.0f, 8.0f, 8.0f, 0.9f, 0);
+    check_detection(result, 2, 55.0f, 5.0f, 8.0f, 8.0f, 0.8f, 1);
+    check_detection(result, 3, 25.0f, 5.0f, 8.0f, 8.0f, 0.7f, 1);
+    check_detection(result, 4, 35.0f, 5.0f, 8.0f, 8.0f, 0.6f, 0);
+    check_detection(result, 5, 65.0f, 5.0f, 8.0f, 8.0f, 0.51f, 0);
+    deep_free_tensors_struct(result);
+}
+
+static void test_yolov8_logits() {
+    const size_t anchors = 5;
+    std::vector<float> data((4 + 3) * anchors, 0.0f);
+    const std::vector<std::vector<float>> logits = {
+        {-1.0f, 2.0f, 2.0f}, {0.0f, 0.0f, -3.0f}, {0.1f, -1.0f, -1.0f}, {-5.0f, -5.0f, -5.0f}, {1.0f, 3.0f, 3.0f},
+    };
+    for (size_t a = 0; a < anchors; a++) set_v8_anchor(data, anchors, a, 10.0f * a + 5.0f, 5.0f, 8.0f, 8.0f, logits[a]);
+
+    PostprocessOptions options;
+    options.stage = "yolov8";
+    options.score_threshold = 0.5f;
+    options.sigmoid = true;
+    tensors_struct *result = run_stage(options, "output0", {1, 7, static_cast<int64_t>(anchors)}, data);
+    // A probability threshold of 0.5 is a logit threshold of 0, which the anchor at 0 does not pass.
+    CHECK(detection_count(result) == 3);
+    check_detection(result, 0, 45.0f, 5.0f, 8.0f, 8.0f, sigmoid(3.0f), 1);
+    check_detection(result, 1, 5.0f, 5.0f, 8.0f, 8.0f, sigmoid(2.0f), 1);
+    check_detection(result, 2, 25.0f, 5.0f, 8.0f, 8.0f, sigmoid(0.1f), 0);
+    deep_free_tensors_struct(result);
+}
+
+static void test_yolov5_threshold() {
+    const size_t classes = 2;
+    std::vector<float> data(5 * (5 + classes), 0.0f);
+    set_v5_anchor(data, classes, 0, 5.0f, 5.0f, 8.0f, 8.0f, 0.9f, {0.8f, 0.1f});
+    set_v5_anchor(data, classes, 1, 15.0f, 5.0f, 8.0f, 8.0f, 0.5f, {1.0f, 1.0f});     // Objectness at the threshold
+    set_v5_anchor(data, classes, 2, 25.0f, 5.0f, 8.0f, 8.0f, 0.9f, {0.5f, 0.5f});     // Product below it
+    set_v5_anchor(data, classes, 3, 35.0f, 5.0f, 8.0f, 8.0f, 0.6f, {0.9f, 0.95f});
+    set_v5_anchor(data, classes, 4, 45.0f, 5.0f, 8.0f, 8.0f, 1.0f, {0.7f, 0.7f});
+
+    PostprocessOptions options;
+    options.stage = "yolov5";
+    options.score_threshold = 0.5f;
+    tensors_struct *result = run_stage(options, "output0", {1, 5, 7}, data);
+    CHECK(detection_count(result) == 3);
+    check_detection(result, 0, 5.0f, 5.0f, 8.0f, 8.0f, 0.9f * 0.8f, 0);
+    check_detection(result, 1, 45.0f, 5.0f, 8.0f, 8.0f, 0.7f, 0);
+    check_detection(result, 2, 35.0f, 5.0f, 8.0f, 8.0f, 0.6f * 0.95f, 1);
+    deep_free_tensors_struct(result);
+}
+
+static void test_yolov5_logits() {
+    const size_t classes = 2;
+    std::vector<float> data(4 * (5 + classes), 0.0f);
+    // Objectness -0.5 is below 0.3 as a raw value but above it as a probability, so only a pre-filter in
+    // the logit domain keeps it.
+    set_v5_anchor(data, classes, 0, 5.0f, 5.0f, 8.0f, 8.0f, -0.5f, {5.0f, -2.0f});
+    set_v5_anchor(data, classes, 1, 15.0f, 5.0f, 8.0f, 8.0f, -1.0f, {10.0f, 10.0f});
+    set_v5_anchor(data, classes, 2, 25.0f, 5.0f, 8.0f, 8.0f, 3.0f, {-1.0f, 2.0f});
+    set_v5_anchor(data, classes, 3, 35.0f, 5.0f, 8.0f, 8.0f, 0.2f, {-1.0f, -1.0f});
+
+    PostprocessOptions options;
+    options.stage = "yolov5";
+    options.score_threshold = 0.3f;
+    options.sigmoid = true;
+    tensors_struct *result = run_stage(options, "output0", {1, 4, 7}, data);
+    CHECK(detection_count(result) == 2);
+    check_detection(result, 0, 25.0f, 5.0f, 8.0f, 8.0f, sigmoid(3.0f) * sigmoid(2.0f), 1);
+    check_detection(result, 1, 5.0f, 5.0f, 8.0f, 8.0f, sigmoid(-0.5f) * sigmoid(5.0f), 0);
+    deep_free_tensors_struct(result);
+}
+
+static void test_yolo_class_aware_nms() {
+    const size_t anchors = 5;
+    std::vector<float> data((4 + 2) * anchors, 0.0f);
+    set_v8_anchor(data, anchors, 0, 50.0f, 50.0f, 20.0f, 20.0f, {0.9f, 0.0f});
+    set_v8_anchor(data, anchors, 1, 52.0f, 50.0f, 20.0f, 20.0f, {0.8f, 0.0f});    // IoU 0.82 with anchor 0
+    set_v8_anchor(data, anchors, 2, 51.0f, 50.0f, 20.0f, 20.0f, {0.0f, 0.85f});   // Same place, other class
+    set_v8_anchor(data, anchors, 3, 62.0f, 50.0f, 20.0f, 20.0f, {0.7f, 0.0f});    // IoU 0.25 with anchor 0
+    set_v8_anchor(data, anchors, 4, 52.0f, 51.0f, 20.0f, 20.0f, {0.0f, 0.6f});    // Suppressed by anchor 2
+
+    PostprocessOptions options;
+    options.stage = "yolov8";
+    options.score_threshold = 0.5f;
+    options.iou_threshold = 0.45f;
+    tensors_struct *result = run_stage(options, "output0", {1, 6, static_cast<int64_t>(anchors)}, data);
+    CHECK(detection_count(result) == 3);
+    check_detection(result, 0, 50.0f, 50.0f, 20.0f, 20.0f, 0.9f, 0);
+    check_detection(result, 1, 51.0f, 50.0f, 20.0f, 20.0f, 0.85f, 1);
+    check_detection(result, 2, 62.0f, 50.0f, 20.0f, 20.0f, 0.7f, 0);
+    deep_free_tensors_struct(result);
+}
+
+static void test_yolo_max_detections() {
+    const size_t anchors = 20;
+    std::vector<float> data((4 + 1) * anchors, 0.0f);
+    for (size_t a = 0; a < anchors; a++) {
+        set_v8_anchor(data, anchors, a, 10.0f * a + 5.0f, 5.0f, 8.0f, 8.0f, {0.5f + 0.02f * a});
+    }
+
+    PostprocessOptions options;
+    options.stage = "yolov8";
+    options.score_threshold = 0.25f;
+    options.max_detections = 5;
+    tensors_struct *result = run_stage(options, "output0", {1, 5, static_cast<int64_t>(anchors)}, data);
+    CHECK(detection_count(result) == 5);
+    for (size_t k = 0; k < 5; k++) {
+        size_t a = anchors - 1 - k;
+        check_detection(result, k, 10.0f * a + 5.0f, 5.0f, 8.0f, 8.0f, 0.5f + 0.02f * a, 0);
+    }
+    deep_free_tensors_struct(result);
+
+    // Fewer candidates than detections cap the result first.
+    options.max_candidates = 3;
+    result = run_stage(options, "output0", {1, 5, static_cast<int64_t>(anchors)}, data);
+    CHECK(detection_count(result) == 3);
+    check_detection(result, 2, 175.0f, 5.0f, 8.0f, 8.0f, 0.5f + 0.02f * 17, 0);
+    deep_free_tensors_struct(result);
+}
+
+// The top-K classes by decreasing logit, the lowest index first among equal logits.
+static std::vector<size_t> reference_top_k(const std::vector<float> &logits, size_t k) {
+    std::vector<size_t> order(logits.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&logits](size_t a, size_t b) { return logits[a] > logits[b]; });
+    order.resize(std::min(k, order.size()));
+    return order;
+}
+
+static void check_classes(const std::vector<float> &logits, size_t k, bool softmax) {
+    PostprocessOptions options;
+    options.stage = "classification";
+    options.top_k = k;
+    options.softmax = softmax;
+    tensors_struct *result = run_stage(options, "logits", {1, static_cast<int64_t>(logits.size())}, logits);
+
+    std::vector<size_t> expected = reference_top_k(logits, k);
+    CHECK(result->num_tensors == 1 && result->ranks[0] == 2);
+    CHECK(result->shapes[0][0] == expected.size() && result->shapes[0][1] == 2);
+    // Softmax over every class, naively in double precision.
+    double max = *std::max_element(logits.begin(), logits.end());
+    double sum = 0.0;
+    for (float logit : logits) sum += exp(logit - max);
+
+    const float *classes = static_cast<const float *>(result->data[0]);
+    for (size_t r = 0; r < expected.size(); r++) {
+        CHECK(classes[r * 2] == static_cast<float>(expected[r]));
+        float logit = logits[expected[r]];
+        if (softmax) {
+            double probability = exp(logit - max) / sum;
+            CHECK(fabs(classes[r * 2 + 1] - probability) <= 1e-5 * probability);
+        } else {
+            CHECK(classes[r * 2 + 1] == logit);
+        }
+    }
+    deep_free_tensors_struct(result);
+}
+
+static void test_classification_top_k() {
+    // Logits on a coarse grid, so that many of them are equal.
+    uint32_t state = 7;
+    const size_t class_counts[] = {1, 3, 4, 7, 10, 1001};
+    const size_t ks[] = {1, 3, 5, 8};
+    for (size_t classes : class_counts) {
+        std::vector<float> logits(classes);
+        for (float &logit : logits) {
+            state = state * 1664525u + 1013904223u;
+            logit = static_cast<float>(static_cast<int>(state >> 24) - 128) / 32.0f;
+        }
+        for (size_t k : ks) {
+            check_classes(logits, k, true);
+            check_classes(logits, k, false);
+        }
+    }
+
+    // The best logits in the scalar tail, after blocks of four that the selection skips.
+    std::vector<float> tail(10, -1.0f);
+    tail[1] = 0.5f;
+    tail[9] = 2.0f;
+    tail[8] = 1.0f;
+    check_classes(tail, 3, true);
+
+    // Equal logits keep the lowest classes, with equal probabilities.
+    std::vector<float> equal(6, 1.0f);
+    check_classes(equal, 3, true);
+    check_classes(equal, 8, false);
+}
+
+static void check_segmentation(size_t channels, size_t height, size_t width, bool confidence, bool softmax) {
+    size_t plane = height * width;
+    std::vector<float> scores(channels * plane);
+    uint32_t state = static_cast<uint32_t>(channels * 31 + plane);
+    for (float &score : scores) {
+        state = state * 1664525u + 1013904223u;
+        score = static_cast<float>(static_cast<int>(state >> 26)) / 4.0f;   // Many equal scores
+    }
+    // The last channel wins somewhere, so labels reach channels - 1.
+    for (size_t p = 0; p < plane; p += 7) scores[(channels - 1) * plane + p] = 100.0f;
+
+    PostprocessOptions options;
+    options.stage = "segmentation";
+    options.confidence = confidence;
+    options.softmax = softmax;
+    tensors_struct *result = run_stage(options, "masks",
+                                       {1, static_cast<int64_t>(channels), static_cast<int64_t>(height),
+                                        static_cast<int64_t>(width)}, scores);
+    CHECK(result->num_tensors == (confidence ? 2u : 1u));
+    for (size_t t = 0; t < result->num_tensors; t++) {
+        CHECK(result->ranks[t] == 2 && result->shapes[t][0] == height && result->shapes[t][1] == width);
+    }
+    CHECK(result->data_types[0] == DATA_TYPE_UINT8);
+    const uint8_t *labels = static_cast<const uint8_t *>(result->data[0]);
+    const float *confidences = confidence ? static_cast<const float *>(result->data[1]) : nullptr;
+
+    for (size_t p = 0; p < plane; p++) {
+        // The first channel with the highest score, and its softmax probability in double precision.
+        size_t best = 0;
+        for (size_t c = 1; c < channels; c++) {
+            if (scores[c * plane + p] > scores[best * plane + p]) best = c;
+        }
+        CHECK(labels[p] == best);
+        if (confidences == nullptr) continue;
+        float best_score = scores[best * plane + p];
+        if (!softmax) {
+            CHECK(confidences[p] == best_score);
+            continue;
+        }
+        double sum = 0.0;
+        for (size_t c = 0; c < channels; c++) sum += exp(static_cast<double>(scores[c * plane + p]) - best_score);
+        CHECK(fabs(confidences[p] - 1.0 / sum) <= 1e-5 / sum);
+    }
+    deep_free_tensors_struct(result);
+}
+
+static void test_segmentation() {
+    // 37 x 29 pixels span a full block of 1024 and a tail that is not a multiple of 4 or 16.
+    check_segmentation(5, 37, 29, false, true);
+    check_segmentation(5, 37, 29, true, true);
+    check_segmentation(5, 37, 29, true, false);
+    check_segmentation(3, 3, 1, true, true);
+    // Labels up to 255 still fit the uint8 output.
+    check_segmentation(256, 37, 29, true, true);
+    check_segmentation(256, 5, 7, true, false);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_yolov8_threshold_and_ties();
+    test_yolov8_logits();
+    test_yolov5_threshold();
+    test_yolov5_logits();
+    test_yolo_class_aware_nms();
+    test_yolo_max_detections();
+    test_classification_top_k();
+    test_segmentation();
+    return 0;
+}
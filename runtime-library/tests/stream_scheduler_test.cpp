@@ -0,0 +1,188 @@
+#include "stream_scheduler.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+// Items are slots of this array, so a popped item tells which input it was.
+static int slots[64];
+
+static void *item(int index) {
+    return &slots[index];
+}
+
+static int index_of(void *popped) {
+    return popped == nullptr ? -1 : static_cast<int>(static_cast<int *>(popped) - slots);
+}
+
+static void test_weights_share_the_admissions() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *heavy = scheduler.add_stream(0, 3, 16);
+    StreamScheduler::Stream *light = scheduler.add_stream(0, 1, 16);
+    for (int i = 0; i < 8; i++) {
+        CHECK(scheduler.push(heavy, item(i), 0, 0));
+        CHECK(scheduler.push(light, item(32 + i), 0, 0));
+    }
+
+    // Three inputs of the heavy stream for each of the light one while both are eligible.
+    const int expected[] = {0, 1, 2, 32, 3, 4, 5, 33, 6, 7, 34, 35, 36, 37, 38, 39};
+    for (int index : expected) {
+        CHECK(index_of(scheduler.pop()) == index);
+    }
+    CHECK(scheduler.pop() == nullptr);
+}
+
+static void test_quota_skips_the_stream_until_complete() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *limited = scheduler.add_stream(1, 1, 16);
+    StreamScheduler::Stream *other = scheduler.add_stream(0, 1, 16);
+    CHECK(scheduler.push(limited, item(0), 0, 0));
+    CHECK(scheduler.push(limited, item(1), 0, 0));
+    CHECK(scheduler.push(other, item(32), 0, 0));
+    CHECK(scheduler.push(other, item(33), 0, 0));
+
+    CHECK(index_of(scheduler.pop()) == 0);
+    CHECK(scheduler.in_flight(limited) == 1);
+    CHECK(index_of(scheduler.pop()) == 32);
+    CHECK(index_of(scheduler.pop()) == 33);
+    CHECK(scheduler.pop() == nullptr);
+
+    scheduler.complete(limited);
+    CHECK(scheduler.in_flight(limited) == 0);
+    CHECK(scheduler.wait_ready());
+    CHECK(index_of(scheduler.pop()) == 1);
+}
+
+static void test_push_blocks_until_the_stream_closes() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *stream = scheduler.add_stream(0, 1, 1);
+    CHECK(scheduler.push(stream, item(0), 0, 0));
+
+    std::atomic<bool> returned(false);
+    std::atomic<bool> accepted(true);
+    std::thread sender([&]() {
+        accepted = scheduler.push(stream, item(1), 0, 0);
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!returned.load());
+
+    std::vector<void *> handed_back = scheduler.close_stream(stream);
+    sender.join();
+    CHECK(returned.load() && !accepted.load());
+    CHECK(handed_back.size() == 1 && index_of(handed_back[0]) == 0);
+    CHECK(scheduler.stats_json().find("\"blocked_sends\":1") != std::string::npos);
+}
+
+static void test_removal_keeps_the_next_turn() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *first = scheduler.add_stream(0, 1, 16);
+    StreamScheduler::Stream *second = scheduler.add_stream(0, 1, 16);
+    StreamScheduler::Stream *third = scheduler.add_stream(0, 1, 16);
+    for (int i = 0; i < 2; i++) {
+        CHECK(scheduler.push(first, item(i), 0, 0));
+        CHECK(scheduler.push(second, item(16 + i), 0, 0));
+        CHECK(scheduler.push(third, item(32 + i), 0, 0));
+    }
+
+    CHECK(index_of(scheduler.pop()) == 0);
+    CHECK(scheduler.close_stream(first).size() == 1);
+    scheduler.remove_stream(first);
+    // The second stream was next when the first was removed, so the third must wait for its turn.
+    CHECK(index_of(scheduler.pop()) == 16);
+    CHECK(index_of(scheduler.pop()) == 32);
+    CHECK(index_of(scheduler.pop()) == 17);
+    CHECK(index_of(scheduler.pop()) == 33);
+    CHECK(scheduler.pop() == nullptr);
+}
+
+static void test_higher_class_overtakes() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *low = scheduler.add_stream(0, 4, 16);
+    StreamScheduler::Stream *high = scheduler.add_stream(0, 1, 16);
+    CHECK(scheduler.push(low, item(0), 0, 0));
+    CHECK(scheduler.push(low, item(1), 0, 0));
+    CHECK(scheduler.push(high, item(32), 5, 0));
+    // Within a stream too, a later input of a higher class goes first.
+    CHECK(scheduler.push(low, item(2), 7, 0));
+
+    CHECK(index_of(scheduler.pop()) == 2);
+    CHECK(index_of(scheduler.pop()) == 32);
+    CHECK(index_of(scheduler.pop()) == 0);
+    CHECK(index_of(scheduler.pop()) == 1);
+}
+
+static void test_earliest_deadline_first_within_a_class() {
+    uint64_t now = scheduler_clock_us();
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *later = scheduler.add_stream(0, 1, 16);
+    StreamScheduler::Stream *sooner = scheduler.add_stream(0, 1, 16);
+    StreamScheduler::Stream *none = scheduler.add_stream(0, 1, 16);
+    CHECK(scheduler.push(none, item(32), 0, 0));
+    CHECK(scheduler.push(later, item(0), 0, now + 3000000000ull));
+    CHECK(scheduler.push(sooner, item(16), 0, now + 1000000000ull));
+    // Inputs without a deadline sort after those with one in the same stream.
+    CHECK(scheduler.push(sooner, item(17), 0, 0));
+    CHECK(scheduler.push(sooner, item(18), 0, now + 2000000000ull));
+
+    CHECK(index_of(scheduler.pop()) == 16);
+    CHECK(index_of(scheduler.pop()) == 18);
+    CHECK(index_of(scheduler.pop()) == 0);
+    // Only inputs without a deadline are left, which take their turns.
+    CHECK(index_of(scheduler.pop()) == 17);
+    CHECK(index_of(scheduler.pop()) == 32);
+    CHECK(scheduler.pop() == nullptr);
+    CHECK(scheduler.stats_json().find("\"late\":0,") != std::string::npos);
+}
+
+static void test_deadline_keeps_the_turn() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *first = scheduler.add_stream(0, 1, 16);
+    StreamScheduler::Stream *second = scheduler.add_stream(0, 1, 16);
+    CHECK(scheduler.push(first, item(0), 0, 0));
+    CHECK(scheduler.push(first, item(1), 0, 0));
+    CHECK(scheduler.push(second, item(16), 0, scheduler_clock_us() + 1000000000ull));
+    CHECK(scheduler.push(second, item(17), 0, 0));
+
+    // The deadline admission of the second stream leaves the turn with the first.
+    CHECK(index_of(scheduler.pop()) == 16);
+    CHECK(index_of(scheduler.pop()) == 0);
+    CHECK(index_of(scheduler.pop()) == 17);
+    CHECK(index_of(scheduler.pop()) == 1);
+    std::string stats = scheduler.stats_json();
+    CHECK(stats.find("\"id\":1,") != std::string::npos);
+    CHECK(stats.find("\"deadline_admissions\":1,") != std::string::npos);
+}
+
+static void test_quota_holds_for_high_priority() {
+    StreamScheduler scheduler;
+    StreamScheduler::Stream *urgent = scheduler.add_stream(1, 1, 16);
+    StreamScheduler::Stream *other = scheduler.add_stream(0, 1, 16);
+    CHECK(scheduler.push(urgent, item(0), 9, scheduler_clock_us() + 1000000000ull));
+    CHECK(scheduler.push(urgent, item(1), 9, scheduler_clock_us() + 1000000000ull));
+    CHECK(scheduler.push(other, item(16), 0, 0));
+
+    CHECK(index_of(scheduler.pop()) == 0);
+    // The throttled stream no longer sets the class, so the lower one is admitted meanwhile.
+    CHECK(index_of(scheduler.pop()) == 16);
+    CHECK(scheduler.pop() == nullptr);
+    scheduler.complete(urgent);
+    CHECK(index_of(scheduler.pop()) == 1);
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_weights_share_the_admissions();
+    test_quota_skips_the_stream_until_complete();
+    test_push_blocks_until_the_stream_closes();
+    test_removal_keeps_the_next_turn();
+    test_higher_class_overtakes();
+    test_earliest_deadline_first_within_a_class();
+    test_deadline_keeps_the_turn();
+    test_quota_holds_for_high_priority();
+    return 0;
+}
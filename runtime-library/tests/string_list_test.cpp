@@ -0,0 +1,53 @@
+#include "string_list.h"
+#include "output_quantization.h"
+#include "thread_placement.h"
+#include "check.h"
+
+#include <spdlog/spdlog.h>
+
+static void test_split_list() {
+    std::vector<std::string> items = split_list(" boxes, scores ,\tlabels\n", ',');
+    CHECK(items.size() == 3);
+    CHECK(items[0] == "boxes" && items[1] == "scores" && items[2] == "labels");
+
+    items = split_list("a,,b,", ',');
+    CHECK(items.size() == 3);
+    CHECK(items[1].empty());
+    CHECK(split_list("", ',').empty());
+    CHECK(trim_whitespace(" \t ").empty());
+}
+
+static void test_cpu_list() {
+    std::vector<int> cpus;
+    CHECK(parse_cpu_list("0-1, 3 ,5", cpus));
+    CHECK(cpus.size() == 4);
+    CHECK(cpus[0] == 0 && cpus[1] == 1 && cpus[2] == 3 && cpus[3] == 5);
+    CHECK(!parse_cpu_list("0-100000", cpus));
+    CHECK(!parse_cpu_list("3-1", cpus));
+    CHECK(!parse_cpu_list(" , ", cpus));
+}
+
+static void test_output_quantization() {
+    std::map<std::string, OutputQuantization> quantizations;
+    CHECK(output_quantization_parse("boxes = int8, 0.5, 3 ; logits=uint8,0.1 / 0.2,0/ 1, 1", quantizations));
+    CHECK(quantizations.size() == 2);
+    const OutputQuantization &boxes = quantizations["boxes"];
+    CHECK(boxes.type == DATA_TYPE_INT8);
+    CHECK(boxes.scales.size() == 1 && boxes.scales[0] == 0.5f);
+    CHECK(boxes.zero_points.size() == 1 && boxes.zero_points[0] == 3);
+    const OutputQuantization &logits = quantizations["logits"];
+    CHECK(logits.type == DATA_TYPE_UINT8);
+    CHECK(logits.scales.size() == 2 && logits.zero_points[1] == 1);
+    CHECK(logits.axis == 1);
+
+    CHECK(!output_quantization_parse("boxes=int8,0.5", quantizations));
+    CHECK(!output_quantization_parse("boxes=int16,0.5,0", quantizations));
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    test_split_list();
+    test_cpu_list();
+    test_output_quantization();
+    return 0;
+}